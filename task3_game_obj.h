@@ -4,6 +4,17 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <cstdint>
+#include <algorithm>
+#include <utility>
+#include <cctype>
+#include <cstdlib>
+#include <cerrno>
+#include <cmath>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+#include "work_stealing_pool.h"
 using namespace std;
 
 // Forward declarations for class relationships
@@ -21,22 +32,566 @@ class WeatherEffect;
 class Post;
 class Athlete;
 
+// Entity-component store behind the game objects. Every Athlete, Reputation, SocialMediaAccount and
+// WeatherEffect is an entity id, and the data the season updates (stats, reputation, engagement, weather
+// modifiers) lives in one dense array per component type instead of inside the objects. The classes
+// below are lightweight handles into a GameWorld, so a system update over 100k athletes is a linear
+// pass over one packed array rather than a walk through pointers. Each handle owns its entity (see
+// OwnedEntity): handles move but do not copy, and the entity's components go with the handle.
+typedef std::uint32_t EntityId;
+
+// Dense storage for one component type (a sparse set). The values are packed back to back in
+// insertion order, and sparse maps an entity id to its position in them, so lookups are O(1)
+// and removal is swap-and-pop.
+template <typename T>
+class ComponentArray {
+private:
+    static constexpr std::uint32_t missing = 0xFFFFFFFFu;
+
+    std::vector<T> values;
+    std::vector<EntityId> owners;       // owners[i] is the entity of values[i]
+    std::vector<std::uint32_t> sparse;  // entity -> position in values, or missing
+
+public:
+    // gives entity the component, or replaces the one it has
+    T& add(EntityId entity, T value) {
+        if (entity >= sparse.size()) {
+            sparse.resize(entity + 1, missing);
+        }
+        if (sparse[entity] != missing) {
+            values[sparse[entity]] = std::move(value);
+            return values[sparse[entity]];
+        }
+        sparse[entity] = (std::uint32_t)values.size();
+        values.push_back(std::move(value));
+        owners.push_back(entity);
+        return values.back();
+    }
+
+    void remove(EntityId entity) {
+        if (!contains(entity)) {
+            return;
+        }
+        std::uint32_t position = sparse[entity];
+        std::uint32_t last = (std::uint32_t)values.size() - 1;
+        if (position != last) {
+            values[position] = std::move(values[last]);
+            owners[position] = owners[last];
+            sparse[owners[position]] = position;
+        }
+        values.pop_back();
+        owners.pop_back();
+        sparse[entity] = missing;
+    }
+
+    bool contains(EntityId entity) const {
+        return entity < sparse.size() && sparse[entity] != missing;
+    }
+
+    // the component of entity, nullptr if it has none
+    T* get(EntityId entity) {
+        return contains(entity) ? &values[sparse[entity]] : nullptr;
+    }
+
+    const T* get(EntityId entity) const {
+        return contains(entity) ? &values[sparse[entity]] : nullptr;
+    }
+
+    void reserve(std::size_t count) {
+        values.reserve(count);
+        owners.reserve(count);
+    }
+
+    std::size_t size() const { return values.size(); }
+    T* data() { return values.data(); }
+    const T* data() const { return values.data(); }
+    EntityId ownerAt(std::size_t position) const { return owners[position]; }
+
+    // calls update(entity, component) for every component, in storage order
+    template <typename Update>
+    void forEach(Update update) {
+        for (std::size_t i = 0; i < values.size(); i++) {
+            update(owners[i], values[i]);
+        }
+    }
+};
+
+// Stat schema: every rating an athlete or team can have, in the order they are packed in a StatBlock.
+// The legacy strings ("speed: 9") use the names in statNames.
+enum class Stat : std::uint8_t {
+    Speed,
+    Strength,
+    Agility,
+    Stamina,
+    Endurance,
+    Accuracy,
+    Awareness,
+    Toughness,
+};
+
+const int statCount = 8;
+static_assert((int)Stat::Toughness + 1 == statCount, "statCount must follow the last Stat");
+
+constexpr const char* statNames[statCount] = {
+    "speed", "strength", "agility", "stamina", "endurance", "accuracy", "awareness", "toughness"
+};
+
+// Ratings of one athlete or team, one int per Stat and 0 for not rated. 32 bytes, aligned so a block
+// loads as exactly two SSE registers.
+struct alignas(16) StatBlock {
+    std::int32_t values[statCount] = {};
+
+    int get(Stat stat) const { return values[(int)stat]; }
+    void set(Stat stat, int value) { values[(int)stat] = value; }
+};
+
+// the Stat called name (any case), false if the schema has none
+inline bool findStat(const std::string& name, Stat& stat) {
+    for (int i = 0; i < statCount; i++) {
+        const char* statName = statNames[i];
+        std::size_t length = std::char_traits<char>::length(statName);
+        if (name.size() != length) {
+            continue;
+        }
+        bool same = true;
+        for (std::size_t c = 0; c < length && same; c++) {
+            same = std::tolower((unsigned char)name[c]) == statName[c];
+        }
+        if (same) {
+            stat = (Stat)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// One-time conversion of legacy "name: value" entries. Entries with an unknown name, no integer value,
+// anything but spaces after it ("9abc", "9.5") or a value that does not fit in an int32 (rather than
+// wrapping it) are skipped, and copied to rejected when it is given.
+inline StatBlock parseLegacyStats(const std::vector<std::string>& entries, std::vector<std::string>* rejected = nullptr) {
+    StatBlock stats;
+    for (const std::string& entry : entries) {
+        std::size_t colon = entry.find(':');
+        Stat stat;
+        bool parsed = false;
+        if (colon != std::string::npos) {
+            std::size_t begin = entry.find_first_not_of(' ');
+            std::size_t end = entry.find_last_not_of(' ', colon - 1);
+            std::string name = begin < colon && end != std::string::npos ? entry.substr(begin, end - begin + 1) : "";
+            const char* value = entry.c_str() + colon + 1;
+            char* valueEnd;
+            errno = 0;
+            long number = std::strtol(value, &valueEnd, 10);
+            bool inRange = errno != ERANGE && number >= INT32_MIN && number <= INT32_MAX;
+            bool whole = entry.find_first_not_of(' ', (std::size_t)(valueEnd - entry.c_str())) == std::string::npos;
+            parsed = valueEnd != value && whole && inRange && findStat(name, stat);
+            if (parsed) {
+                stats.set(stat, (int)number);
+            }
+        }
+        if (!parsed && rejected != nullptr) {
+            rejected->push_back(entry);
+        }
+    }
+    return stats;
+}
+
+// back to legacy strings, rated stats only, in schema order
+inline std::vector<std::string> formatLegacyStats(const StatBlock& stats) {
+    std::vector<std::string> entries;
+    for (int i = 0; i < statCount; i++) {
+        if (stats.values[i] != 0) {
+            entries.push_back(std::string(statNames[i]) + ": " + std::to_string(stats.values[i]));
+        }
+    }
+    return entries;
+}
+
+// Team rating for every stat: the players' mean, rounded to the nearest integer (0 without players).
+// The sums run a whole StatBlock at a time in SSE2 registers where available, and the result is the
+// same either way since it is all integer arithmetic.
+inline StatBlock aggregateTeamRatings(const StatBlock* players, std::size_t count) {
+    StatBlock team;
+    if (count == 0) {
+        return team;
+    }
+    alignas(16) std::int64_t sums[statCount] = {};
+#if defined(__SSE2__) || defined(_M_X64)
+    // Every rating is sign extended into a 64 bit lane, so no int32 ratings can overflow the sums the
+    // way 32 bit lanes do (65536 players rated 40000 already wrap those).
+    __m128i sums01 = _mm_setzero_si128();
+    __m128i sums23 = _mm_setzero_si128();
+    __m128i sums45 = _mm_setzero_si128();
+    __m128i sums67 = _mm_setzero_si128();
+    for (std::size_t i = 0; i < count; i++) {
+        __m128i low = _mm_load_si128((const __m128i*)players[i].values);
+        __m128i high = _mm_load_si128((const __m128i*)(players[i].values + 4));
+        __m128i lowSign = _mm_srai_epi32(low, 31);
+        __m128i highSign = _mm_srai_epi32(high, 31);
+        sums01 = _mm_add_epi64(sums01, _mm_unpacklo_epi32(low, lowSign));
+        sums23 = _mm_add_epi64(sums23, _mm_unpackhi_epi32(low, lowSign));
+        sums45 = _mm_add_epi64(sums45, _mm_unpacklo_epi32(high, highSign));
+        sums67 = _mm_add_epi64(sums67, _mm_unpackhi_epi32(high, highSign));
+    }
+    _mm_store_si128((__m128i*)sums, sums01);
+    _mm_store_si128((__m128i*)(sums + 2), sums23);
+    _mm_store_si128((__m128i*)(sums + 4), sums45);
+    _mm_store_si128((__m128i*)(sums + 6), sums67);
+#else
+    for (std::size_t i = 0; i < count; i++) {
+        for (int s = 0; s < statCount; s++) {
+            sums[s] += players[i].values[s];
+        }
+    }
+#endif
+    std::int64_t players64 = (std::int64_t)count;
+    for (int s = 0; s < statCount; s++) {
+        // round half away from zero
+        std::int64_t twice = sums[s] * 2;
+        team.values[s] = (std::int32_t)((twice >= 0 ? twice + players64 : twice - players64) / (2 * players64));
+    }
+    return team;
+}
+
+// What the weather does to the field, as a bit set (FieldImpacts) of these, parsed once from the
+// free-form impact strings of WeatherEvent and WeatherEffect
+enum FieldImpact : std::uint8_t {
+    FieldWet = 1 << 0,
+    FieldSlippery = 1 << 1,
+    FieldFrozen = 1 << 2,
+    FieldMuddy = 1 << 3,
+    FieldWindy = 1 << 4,
+    FieldLowVisibility = 1 << 5,
+};
+
+typedef std::uint8_t FieldImpacts;
+
+const int fieldImpactCount = 6;
+
+// how much each FieldImpact lowers each Stat, in Stat order
+constexpr std::int32_t fieldImpactPenalties[fieldImpactCount][statCount] = {
+    { 0, 0, 0, 0, 0, 1, 0, 0 }, // wet: accuracy
+    { 1, 0, 2, 0, 0, 0, 0, 0 }, // slippery: speed, agility
+    { 2, 0, 1, 0, 0, 0, 0, 1 }, // frozen: speed, agility, toughness
+    { 1, 0, 0, 1, 1, 0, 0, 0 }, // muddy: speed, stamina, endurance
+    { 0, 0, 0, 0, 0, 2, 1, 0 }, // windy: accuracy, awareness
+    { 0, 0, 0, 0, 0, 1, 2, 0 }, // low visibility: accuracy, awareness
+};
+
+inline std::string toLower(const std::string& text) {
+    std::string lower = text;
+    for (char& c : lower) {
+        c = (char)std::tolower((unsigned char)c);
+    }
+    return lower;
+}
+
+// Every FieldImpact with a keyword among the words of text, e.g. "wet and slippery field". Only whole
+// words count, so "nice" is not "ice" and "windows" is not "wind".
+inline FieldImpacts parseFieldImpacts(const std::string& text) {
+    static const std::pair<FieldImpact, const char*> keywords[] = {
+        { FieldWet, "wet" }, { FieldWet, "rain" }, { FieldWet, "rainy" }, { FieldWet, "raining" },
+        { FieldSlippery, "slip" }, { FieldSlippery, "slippery" }, { FieldSlippery, "slick" },
+        { FieldFrozen, "frozen" }, { FieldFrozen, "ice" }, { FieldFrozen, "icy" }, { FieldFrozen, "iced" },
+        { FieldMuddy, "mud" }, { FieldMuddy, "muddy" }, { FieldWindy, "wind" }, { FieldWindy, "windy" },
+        { FieldLowVisibility, "visibility" }, { FieldLowVisibility, "fog" }, { FieldLowVisibility, "foggy" },
+    };
+    std::string lower = toLower(text);
+    FieldImpacts impacts = 0;
+    std::size_t begin = 0;
+    while (begin < lower.size()) {
+        if (!std::isalpha((unsigned char)lower[begin])) {
+            begin++;
+            continue;
+        }
+        std::size_t end = begin;
+        while (end < lower.size() && std::isalpha((unsigned char)lower[end])) {
+            end++;
+        }
+        for (const auto& keyword : keywords) {
+            if (lower.compare(begin, end - begin, keyword.second) == 0) {
+                impacts |= keyword.first;
+            }
+        }
+        begin = end;
+    }
+    return impacts;
+}
+
+// the summed penalties of every impact in impacts
+inline StatBlock fieldPenalty(FieldImpacts impacts) {
+    StatBlock penalty;
+    for (int bit = 0; bit < fieldImpactCount; bit++) {
+        if (impacts & (1 << bit)) {
+            for (int s = 0; s < statCount; s++) {
+                penalty.values[s] += fieldImpactPenalties[bit][s];
+            }
+        }
+    }
+    return penalty;
+}
+
+// stats as they play on a field with impacts, no stat goes below 0
+inline StatBlock applyFieldImpacts(const StatBlock& stats, FieldImpacts impacts) {
+    StatBlock penalty = fieldPenalty(impacts);
+    StatBlock adjusted;
+    for (int s = 0; s < statCount; s++) {
+        adjusted.values[s] = std::max(0, stats.values[s] - penalty.values[s]);
+    }
+    return adjusted;
+}
+
+// Social interactions the engagement counters track, and how much each one weighs in the rate
+enum class InteractionKind : std::uint8_t {
+    Like,
+    Comment,
+    Share,
+};
+
+const int interactionKindCount = 3;
+
+constexpr const char* interactionKindNames[interactionKindCount] = { "like", "comment", "share" };
+constexpr double interactionWeights[interactionKindCount] = { 1.0, 2.0, 3.0 };
+
+// the InteractionKind text starts with ("Liked" is Like, "reply" counts as Comment), false if none
+inline bool parseInteractionKind(const std::string& text, InteractionKind& kind) {
+    std::string lower = toLower(text);
+    std::size_t begin = lower.find_first_not_of(' ');
+    if (begin == std::string::npos) {
+        return false;
+    }
+    for (int i = 0; i < interactionKindCount; i++) {
+        if (lower.compare(begin, std::char_traits<char>::length(interactionKindNames[i]), interactionKindNames[i]) == 0) {
+            kind = (InteractionKind)i;
+            return true;
+        }
+    }
+    if (lower.compare(begin, 5, "reply") == 0) {
+        kind = InteractionKind::Comment;
+        return true;
+    }
+    return false;
+}
+
+// Time-decayed windows over interactions, times are in seconds. In each window an interaction counts 1
+// when it happens and half as much every half-life after that. A steady stream of r interactions a
+// half-life fills a window up to r / ln 2, which is how engagementRateAt turns the day window into a rate.
+const int engagementWindowCount = 3;
+constexpr std::int64_t engagementHalfLives[engagementWindowCount] = { 3600, 86400, 7 * 86400 }; // hour, day, week
+const int engagementRateWindow = 1; // the rate is over the day window
+
+// Components (an athlete's stats component is its StatBlock)
+
+struct ReputationComponent {
+    int reputationScore;
+    int fansSupport;
+};
+
+// Engagement of an account, kept up to date incrementally as interactions arrive (see recordEngagement),
+// so nothing is ever recomputed from the posts and followers
+struct EngagementComponent {
+    double engagementRate; // as given, until the first interaction is recorded; same units as engagementRateAt
+    int followerCount;
+    std::int64_t totals[interactionKindCount] = {}; // every interaction so far, never decayed
+    double windows[engagementWindowCount][interactionKindCount] = {}; // decayed counts as of updated
+    std::int64_t updated = 0; // time of the latest interaction
+};
+
+// Adds count interactions of kind at time. The windows only decay when they are touched, so this is
+// O(windows) whatever the history: they decay to time first, or an interaction older than the latest
+// is added already decayed. The windows equal decaying every interaction on its own and summing, up to
+// floating-point rounding (the order of the multiplications differs).
+inline void recordEngagement(EngagementComponent& engagement, InteractionKind kind, std::int64_t time, int count = 1) {
+    bool first = true;
+    for (int k = 0; k < interactionKindCount; k++) {
+        first = first && engagement.totals[k] == 0;
+    }
+    if (first) {
+        engagement.updated = time;
+    }
+    for (int w = 0; w < engagementWindowCount; w++) {
+        double halfLives = (double)(time - engagement.updated) / (double)engagementHalfLives[w];
+        if (halfLives > 0) {
+            for (int k = 0; k < interactionKindCount; k++) {
+                engagement.windows[w][k] *= std::exp2(-halfLives);
+            }
+            engagement.windows[w][(int)kind] += count;
+        } else {
+            engagement.windows[w][(int)kind] += count * std::exp2(halfLives);
+        }
+    }
+    engagement.totals[(int)kind] += count;
+    engagement.updated = std::max(engagement.updated, time);
+}
+
+// the interactions of kind in window, decayed to now (no earlier than the latest interaction)
+inline double decayedEngagement(const EngagementComponent& engagement, int window, InteractionKind kind, std::int64_t now) {
+    double halfLives = (double)std::max<std::int64_t>(0, now - engagement.updated) / (double)engagementHalfLives[window];
+    return engagement.windows[window][(int)kind] * std::exp2(-halfLives);
+}
+
+// Weighted interactions per follower per day (likes count 1, comments 2, shares 3), from the day window
+// decayed to now: a steady day of 50 likes on an account of 100 followers is a rate of 0.5. Before any
+// interaction is recorded it is the rate the account was created with, which is in the same units.
+inline double engagementRateAt(const EngagementComponent& engagement, std::int64_t now) {
+    std::int64_t interactions = 0;
+    for (int k = 0; k < interactionKindCount; k++) {
+        interactions += engagement.totals[k];
+    }
+    if (interactions == 0) {
+        return engagement.engagementRate;
+    }
+    double weighted = 0;
+    for (int k = 0; k < interactionKindCount; k++) {
+        weighted += interactionWeights[k] * decayedEngagement(engagement, engagementRateWindow, (InteractionKind)k, now);
+    }
+    double perDay = weighted * std::log(2.0) * 86400.0 / (double)engagementHalfLives[engagementRateWindow];
+    return perDay / std::max(1, engagement.followerCount);
+}
+
+// The weather an athlete adapted to (see Athlete::adaptToWeather) and the stamina it has left
+struct WeatherModifierComponent {
+    EntityId weatherEffect; // the WeatherEffect entity
+    int staminaImpact;      // copied from it, so applying weather only reads this array
+    FieldImpacts fieldImpacts; // copied as well
+    int stamina;
+};
+
+const int fullStamina = 100;
+const int maxReputationScore = 100;
+
+// Owns every component. Entity ids are never reused, so a handle to a destroyed entity just finds
+// no components instead of someone else's.
+class GameWorld {
+private:
+    EntityId nextEntity;
+
+public:
+    ComponentArray<StatBlock> stats;
+    ComponentArray<ReputationComponent> reputations;
+    ComponentArray<EngagementComponent> engagements;
+    ComponentArray<WeatherModifierComponent> weatherModifiers;
+
+    GameWorld() {
+        nextEntity = 0;
+    }
+
+    GameWorld(const GameWorld&) = delete;
+    GameWorld& operator=(const GameWorld&) = delete;
+
+    // the world of objects made with the original constructors, which take no GameWorld
+    static GameWorld& defaultWorld() {
+        static GameWorld world;
+        return world;
+    }
+
+    EntityId createEntity() { return nextEntity++; }
+
+    // drops every component of entity, handles to it stay safe to use but see default values
+    void destroyEntity(EntityId entity) {
+        stats.remove(entity);
+        reputations.remove(entity);
+        engagements.remove(entity);
+        weatherModifiers.remove(entity);
+    }
+
+    std::size_t getEntityCount() const { return nextEntity; }
+
+    // Systems: each is one pass over a packed component array
+
+    // moves every reputation score by delta, kept within 0..maxReputationScore
+    void updateReputations(int delta) {
+        ReputationComponent* reputation = reputations.data();
+        for (std::size_t i = 0; i < reputations.size(); i++) {
+            reputation[i].reputationScore = std::clamp(reputation[i].reputationScore + delta, 0, maxReputationScore);
+        }
+    }
+
+    // every athlete playing in weather loses that weather's stamina impact, down to 0
+    void applyWeatherEffects() {
+        WeatherModifierComponent* modifier = weatherModifiers.data();
+        for (std::size_t i = 0; i < weatherModifiers.size(); i++) {
+            modifier[i].stamina = std::max(0, modifier[i].stamina - modifier[i].staminaImpact);
+        }
+    }
+
+    // the same, only for athletes that adapted to one WeatherEffect
+    void applyWeatherEffect(EntityId weatherEffect) {
+        WeatherModifierComponent* modifier = weatherModifiers.data();
+        for (std::size_t i = 0; i < weatherModifiers.size(); i++) {
+            if (modifier[i].weatherEffect == weatherEffect) {
+                modifier[i].stamina = std::max(0, modifier[i].stamina - modifier[i].staminaImpact);
+            }
+        }
+    }
+};
+
+// The entity of a handle class (Athlete, Reputation, SocialMediaAccount, WeatherEffect), created with
+// the handle and destroyed with it. It can be moved but not copied, so exactly one handle owns each
+// entity; a moved-from handle still reads the entity until its new owner destroys it, then sees defaults.
+class OwnedEntity {
+private:
+    GameWorld* world; // nullptr once moved from
+    EntityId id;
+
+    void release() {
+        if (world != nullptr) {
+            world->destroyEntity(id);
+        }
+    }
+
+public:
+    explicit OwnedEntity(GameWorld& world) {
+        this->world = &world;
+        id = world.createEntity();
+    }
+
+    OwnedEntity(OwnedEntity&& other) noexcept {
+        world = std::exchange(other.world, nullptr);
+        id = other.id;
+    }
+
+    OwnedEntity& operator=(OwnedEntity&& other) noexcept {
+        if (this != &other) {
+            release();
+            world = std::exchange(other.world, nullptr);
+            id = other.id;
+        }
+        return *this;
+    }
+
+    ~OwnedEntity() { release(); }
+
+    operator EntityId() const { return id; }
+};
+
 // Class representing an Athlete
 class Athlete {
 private:
+    GameWorld* world;
+    OwnedEntity entity; // has the athlete's StatBlock, and a WeatherModifierComponent once it adapts to weather
     std::string name;
     std::string position;
-    std::vector<std::string> athleticStats; // E.g., {"speed: 9", "strength: 8"}
     Reputation* reputation;  // 1-to-1 with Reputation
     SocialMediaAccount* socialMediaAccount; // 1-to-1 with SocialMediaAccount
     std::vector<FanInteraction*> fanInteractions; // 1-to-many relationship
     std::vector<Game*> games; // Many-to-many relationship
 
 public:
-    Athlete(std::string name, std::string position, std::vector<std::string> athleticStats) {
+    Athlete(std::string name, std::string position, std::vector<std::string> athleticStats)
+        : Athlete(GameWorld::defaultWorld(), name, position, athleticStats) {
+    }
+
+    // athleticStats are legacy strings, e.g. {"speed: 9", "strength: 8"}, parsed once into a StatBlock
+    Athlete(GameWorld& world, std::string name, std::string position, std::vector<std::string> athleticStats)
+        : Athlete(world, name, position, parseLegacyStats(athleticStats)) {
+    }
+
+    Athlete(GameWorld& world, std::string name, std::string position, const StatBlock& stats) : entity(world) {
+        this->world = &world;
         this->name = name;
         this->position = position;
-        this->athleticStats = athleticStats;
+        world.stats.add(entity, stats);
         reputation = nullptr;
         socialMediaAccount = nullptr;
     }
@@ -54,35 +609,110 @@ public:
 
     std::string getName() const { return name; }
     std::string getPosition() const { return position; }
+    EntityId getEntity() const { return entity; }
+
+    StatBlock getStats() const {
+        const StatBlock* stats = world->stats.get(entity);
+        return stats != nullptr ? *stats : StatBlock();
+    }
+
+    int getStat(Stat stat) const { return getStats().get(stat); }
+    StatBlock getWeatherAdjustedStats() const;
+
+    // the stats in the legacy "speed: 9" form
+    std::vector<std::string> getAthleticStats() const { return formatLegacyStats(getStats()); }
+
+    int getStamina() const {
+        const WeatherModifierComponent* modifier = world->weatherModifiers.get(entity);
+        return modifier != nullptr ? modifier->stamina : fullStamina;
+    }
 };
 
 // Class representing SocialMediaAccount
 class SocialMediaAccount {
 private:
+    GameWorld* world;
+    OwnedEntity entity; // has the account's EngagementComponent
     std::vector<Follower*> followers; // Many-to-1 with Follower
-    double engagementRate;
     std::string accountType;
     std::vector<Post*> posts; // 1-to-many relationship with Post
     std::vector<Sponsorship*> sponsorships; // 1-to-many with Sponsorship
 
 public:
-    SocialMediaAccount(double engagementRate, std::string accountType) {
-        this->engagementRate = engagementRate;
+    // engagementRate is weighted interactions per follower per day, see engagementRateAt
+    SocialMediaAccount(double engagementRate, std::string accountType)
+        : SocialMediaAccount(GameWorld::defaultWorld(), engagementRate, accountType) {
+    }
+
+    SocialMediaAccount(GameWorld& world, double engagementRate, std::string accountType) : entity(world) {
+        this->world = &world;
+        world.engagements.add(entity, EngagementComponent{ engagementRate, 0 });
         this->accountType = accountType;
     }
 
     void postContent(Post* post);
-    void gainFollowers(int numFollowers);
-    void loseFollowers(int numFollowers);
     void updateEngagement();
 
+    void gainFollowers(int numFollowers) {
+        if (EngagementComponent* engagement = world->engagements.get(entity)) {
+            engagement->followerCount += numFollowers;
+        }
+    }
+
+    void loseFollowers(int numFollowers) {
+        if (EngagementComponent* engagement = world->engagements.get(entity)) {
+            engagement->followerCount = std::max(0, engagement->followerCount - numFollowers);
+        }
+    }
+
+    // counts an interaction with the account's content, in O(1)
+    void recordInteraction(InteractionKind kind, std::int64_t time, int count = 1) {
+        if (EngagementComponent* engagement = world->engagements.get(entity)) {
+            recordEngagement(*engagement, kind, time, count);
+        }
+    }
+
+    // the same for a fan's like, comment or share, other interactions are not engagement
+    void recordFanInteraction(const FanInteraction& interaction, std::int64_t time);
+
     // Setters and Getters
-    void addPost(Post* post) { posts.push_back(post); }
+    void addPost(Post* post);
     void addSponsorship(Sponsorship* sponsorship) { sponsorships.push_back(sponsorship); }
-    void addFollower(Follower* follower) { followers.push_back(follower); }
+    // keeps follower and counts it in getFollowerCount, so it divides the engagement rate
+    void addFollower(Follower* follower) {
+        followers.push_back(follower);
+        gainFollowers(1);
+    }
 
-    double getEngagementRate() const { return engagementRate; }
     std::string getAccountType() const { return accountType; }
+    EntityId getEntity() const { return entity; }
+
+    // The rate as of the latest interaction, see engagementRateAt. It is O(1) but does not decay while no
+    // interactions arrive, so an account that went quiet keeps its last rate; pass now for the current one.
+    double getEngagementRate() const {
+        const EngagementComponent* engagement = world->engagements.get(entity);
+        return engagement != nullptr ? engagementRateAt(*engagement, engagement->updated) : 0.0;
+    }
+
+    double getEngagementRate(std::int64_t now) const {
+        const EngagementComponent* engagement = world->engagements.get(entity);
+        return engagement != nullptr ? engagementRateAt(*engagement, now) : 0.0;
+    }
+
+    std::int64_t getInteractionCount(InteractionKind kind) const {
+        const EngagementComponent* engagement = world->engagements.get(entity);
+        return engagement != nullptr ? engagement->totals[(int)kind] : 0;
+    }
+
+    double getDecayedInteractions(int window, InteractionKind kind, std::int64_t now) const {
+        const EngagementComponent* engagement = world->engagements.get(entity);
+        return engagement != nullptr ? decayedEngagement(*engagement, window, kind, now) : 0.0;
+    }
+
+    int getFollowerCount() const {
+        const EngagementComponent* engagement = world->engagements.get(entity);
+        return engagement != nullptr ? engagement->followerCount : 0;
+    }
 };
 
 // Class representing Post
@@ -94,6 +724,7 @@ private:
     int comments;
     int shares;
     std::vector<FanInteraction*> fanInteractions; // 1-to-many relationship with FanInteraction
+    SocialMediaAccount* account; // the account that posted it, if any
 
 public:
     Post(std::string contentType, std::string postDate, int likes, int comments, int shares) {
@@ -102,6 +733,21 @@ public:
         this->likes = likes;
         this->comments = comments;
         this->shares = shares;
+        account = nullptr;
+    }
+
+    // counts an interaction on this post, and on its account's engagement
+    void recordInteraction(InteractionKind kind, std::int64_t time) {
+        if (kind == InteractionKind::Like) {
+            likes++;
+        } else if (kind == InteractionKind::Comment) {
+            comments++;
+        } else {
+            shares++;
+        }
+        if (account != nullptr) {
+            account->recordInteraction(kind, time);
+        }
     }
 
     void createPost();
@@ -112,8 +758,20 @@ public:
     void addFanInteraction(FanInteraction* interaction) { fanInteractions.push_back(interaction); }
     std::string getContentType() const { return contentType; }
     std::string getPostDate() const { return postDate; }
+    void setAccount(SocialMediaAccount* account) { this->account = account; }
+    int getLikes() const { return likes; }
+    int getComments() const { return comments; }
+    int getShares() const { return shares; }
 };
 
+// running likes, comments and shares together
+inline int Post::getEngagement() { return likes + comments + shares; }
+
+inline void SocialMediaAccount::addPost(Post* post) {
+    posts.push_back(post);
+    post->setAccount(this);
+}
+
 // Class representing Follower
 class Follower {
 private:
@@ -129,6 +787,8 @@ public:
     }
 
     void interactWithPost(Post* post);
+
+    void interactWithPost(Post* post, InteractionKind kind, std::int64_t time) { post->recordInteraction(kind, time); }
     void increaseEngagement();
 
     // Setters and Getters
@@ -168,6 +828,7 @@ private:
     int severity;
     int duration;
     std::string impactOnGameplay;
+    FieldImpacts fieldImpacts;  // impactOnGameplay, parsed
 
 public:
     WeatherEvent(std::string weatherType, int severity, int duration, std::string impactOnGameplay) {
@@ -175,6 +836,7 @@ public:
         this->severity = severity;
         this->duration = duration;
         this->impactOnGameplay = impactOnGameplay;
+        fieldImpacts = parseFieldImpacts(impactOnGameplay);
     }
 
     void generateWeatherEvent();
@@ -183,6 +845,7 @@ public:
     // Setters and Getters
     std::string getWeatherType() const { return weatherType; }
     int getSeverity() const { return severity; }
+    FieldImpacts getFieldImpacts() const { return fieldImpacts; }
 };
 
 // Class representing Game
@@ -198,6 +861,7 @@ public:
         this->gameTime = gameTime;
         this->weather = weather;
         this->teamsInvolved = teamsInvolved;
+        score = std::make_pair(0, 0);
     }
 
     void startGame();
@@ -206,19 +870,27 @@ public:
     void addTeam(Team* team) { teamsInvolved.push_back(team); }
 
     // Setters and Getters
+    void setScore(int team1Score, int team2Score) { score = std::make_pair(team1Score, team2Score); }
     std::string getGameTime() const { return gameTime; }
+    WeatherEvent* getWeather() const { return weather; }
     std::pair<int, int> getScore() const { return score; }
+    const std::vector<Team*>& getTeams() const { return teamsInvolved; }
 };
 
 // Class representing Team
 class Team {
 private:
     std::string teamName;
-    std::vector<std::string> teamStats;
+    StatBlock teamStats;
     std::vector<Athlete*> players; // 1-to-many relationship with Athlete
 
 public:
     Team(std::string teamName, std::vector<std::string> teamStats) {
+        this->teamName = teamName;
+        this->teamStats = parseLegacyStats(teamStats);
+    }
+
+    Team(std::string teamName, const StatBlock& teamStats) {
         this->teamName = teamName;
         this->teamStats = teamStats;
     }
@@ -227,8 +899,21 @@ public:
     void strategizeForWeather(WeatherEvent* weatherEvent);
     void addPlayer(Athlete* player) { players.push_back(player); }
 
+    // the players' mean rating for every stat, see aggregateTeamRatings
+    StatBlock getPlayerRatings() const {
+        std::vector<StatBlock> ratings;
+        ratings.reserve(players.size());
+        for (const Athlete* player : players) {
+            ratings.push_back(player->getStats());
+        }
+        return aggregateTeamRatings(ratings.data(), ratings.size());
+    }
+
     // Setters and Getters
     std::string getTeamName() const { return teamName; }
+    StatBlock getTeamStats() const { return teamStats; }
+    std::size_t getPlayerCount() const { return players.size(); }
+    const std::vector<Athlete*>& getPlayers() const { return players; }
 };
 
 // Class representing Stadium
@@ -257,20 +942,38 @@ private:
     std::string interactionType;
     std::string fanName;
     std::string message;
+    bool engagement; // whether interactionType is a like, comment or share
+    InteractionKind kind;
 
 public:
     FanInteraction(std::string interactionType, std::string fanName, std::string message) {
         this->interactionType = interactionType;
         this->fanName = fanName;
         this->message = message;
+        kind = InteractionKind::Like;
+        engagement = parseInteractionKind(interactionType, kind);
     }
 
     void interact();
 
     // Setters and Getters
     std::string getFanName() const { return fanName; }
+    std::string getInteractionType() const { return interactionType; }
+
+    // the interaction's kind, false when it is not engagement
+    bool getKind(InteractionKind& kind) const {
+        kind = this->kind;
+        return engagement;
+    }
 };
 
+inline void SocialMediaAccount::recordFanInteraction(const FanInteraction& interaction, std::int64_t time) {
+    InteractionKind kind;
+    if (interaction.getKind(kind)) {
+        recordInteraction(kind, time);
+    }
+}
+
 // Class representing EventImpact
 class EventImpact {
 private:
@@ -294,42 +997,414 @@ public:
 // Class representing Reputation
 class Reputation {
 private:
-    int reputationScore;
-    int fansSupport;
+    GameWorld* world;
+    OwnedEntity entity; // has the ReputationComponent, GameWorld::updateReputations moves all of them at once
+
+    void changeReputation(int delta) {
+        if (ReputationComponent* reputation = world->reputations.get(entity)) {
+            reputation->reputationScore = std::clamp(reputation->reputationScore + delta, 0, maxReputationScore);
+        }
+    }
 
 public:
-    Reputation(int reputationScore, int fansSupport) {
-        this->reputationScore = reputationScore;
-        this->fansSupport = fansSupport;
+    Reputation(int reputationScore, int fansSupport)
+        : Reputation(GameWorld::defaultWorld(), reputationScore, fansSupport) {
+    }
+
+    Reputation(GameWorld& world, int reputationScore, int fansSupport) : entity(world) {
+        this->world = &world;
+        world.reputations.add(entity, ReputationComponent{ reputationScore, fansSupport });
     }
 
-    void increaseReputation();
-    void decreaseReputation();
+    void increaseReputation() { changeReputation(1); }
+    void decreaseReputation() { changeReputation(-1); }
 
     // Setters and Getters
-    int getReputationScore() const { return reputationScore; }
+    EntityId getEntity() const { return entity; }
+
+    int getReputationScore() const {
+        const ReputationComponent* reputation = world->reputations.get(entity);
+        return reputation != nullptr ? reputation->reputationScore : 0;
+    }
+
+    int getFansSupport() const {
+        const ReputationComponent* reputation = world->reputations.get(entity);
+        return reputation != nullptr ? reputation->fansSupport : 0;
+    }
 };
 
 // Class representing WeatherEffect
 class WeatherEffect {
 private:
+    GameWorld* world;
+    OwnedEntity entity; // athletes that adapted to this weather point here from their WeatherModifierComponent
     int staminaImpact;
     std::string fieldImpact;
     std::string weatherType;
+    FieldImpacts fieldImpacts;  // fieldImpact, parsed
 
 public:
-    WeatherEffect(int staminaImpact, std::string fieldImpact, std::string weatherType) {
+    WeatherEffect(int staminaImpact, std::string fieldImpact, std::string weatherType)
+        : WeatherEffect(GameWorld::defaultWorld(), staminaImpact, fieldImpact, weatherType) {
+    }
+
+    WeatherEffect(GameWorld& world, int staminaImpact, std::string fieldImpact, std::string weatherType) : entity(world) {
+        this->world = &world;
         this->staminaImpact = staminaImpact;
         this->fieldImpact = fieldImpact;
         this->weatherType = weatherType;
+        fieldImpacts = parseFieldImpacts(fieldImpact);
     }
 
-    void applyWeatherEffect();
+    // every athlete that adapted to this weather loses staminaImpact, in one pass over the modifiers
+    void applyWeatherEffect() { world->applyWeatherEffect(entity); }
 
     // Setters and Getters
+    EntityId getEntity() const { return entity; }
     int getStaminaImpact() const { return staminaImpact; }
     std::string getFieldImpact() const { return fieldImpact; }
+    FieldImpacts getFieldImpacts() const { return fieldImpacts; }
+};
+
+// the athlete now plays in weatherEffect's weather and keeps the stamina it has left
+inline void Athlete::adaptToWeather(WeatherEffect* weatherEffect) {
+    int stamina = getStamina();
+    world->weatherModifiers.add(entity, WeatherModifierComponent{ weatherEffect->getEntity(), weatherEffect->getStaminaImpact(), weatherEffect->getFieldImpacts(), stamina });
+}
+
+// the athlete's stats on the field of the weather it adapted to
+inline StatBlock Athlete::getWeatherAdjustedStats() const {
+    const WeatherModifierComponent* modifier = world->weatherModifiers.get(entity);
+    return modifier != nullptr ? applyFieldImpacts(getStats(), modifier->fieldImpacts) : getStats();
+}
+
+// Weather kernels, SSE2 where available with a scalar fallback. Both compute exactly what the per-object
+// path does (WeatherEffect::applyWeatherEffect and applyFieldImpacts), only over packed arrays.
+
+// stamina[i] = max(0, stamina[i] - staminaImpact[i])
+inline void applyStaminaKernel(std::int32_t* stamina, const std::int32_t* staminaImpact, std::size_t count) {
+    std::size_t i = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 4 <= count; i += 4) {
+        __m128i left = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)(stamina + i)), _mm_loadu_si128((const __m128i*)(staminaImpact + i)));
+        // SSE2 has no max_epi32, keep the lanes that are above 0
+        _mm_storeu_si128((__m128i*)(stamina + i), _mm_and_si128(left, _mm_cmpgt_epi32(left, zero)));
+    }
+#endif
+    for (; i < count; i++) {
+        stamina[i] = std::max(0, stamina[i] - staminaImpact[i]);
+    }
+}
+
+// stats[i] = applyFieldImpacts(stats[i], impacts[i]), with the penalty of every impact set looked up
+// instead of summed
+inline void applyFieldKernel(StatBlock* stats, const FieldImpacts* impacts, std::size_t count) {
+    static const std::vector<StatBlock> penalties = [] {
+        std::vector<StatBlock> table;
+        for (int set = 0; set < (1 << fieldImpactCount); set++) {
+            table.push_back(fieldPenalty((FieldImpacts)set));
+        }
+        return table;
+    }();
+    const FieldImpacts mask = (1 << fieldImpactCount) - 1;
+#if defined(__SSE2__) || defined(_M_X64)
+    const __m128i zero = _mm_setzero_si128();
+    for (std::size_t i = 0; i < count; i++) {
+        const StatBlock& penalty = penalties[impacts[i] & mask];
+        __m128i* values = (__m128i*)stats[i].values;
+        __m128i low = _mm_sub_epi32(_mm_load_si128(values), _mm_load_si128((const __m128i*)penalty.values));
+        __m128i high = _mm_sub_epi32(_mm_load_si128(values + 1), _mm_load_si128((const __m128i*)(penalty.values + 4)));
+        _mm_store_si128(values, _mm_and_si128(low, _mm_cmpgt_epi32(low, zero)));
+        _mm_store_si128(values + 1, _mm_and_si128(high, _mm_cmpgt_epi32(high, zero)));
+    }
+#else
+    for (std::size_t i = 0; i < count; i++) {
+        const StatBlock& penalty = penalties[impacts[i] & mask];
+        for (int s = 0; s < statCount; s++) {
+            stats[i].values[s] = std::max(0, stats[i].values[s] - penalty.values[s]);
+        }
+    }
+#endif
+}
+
+// Batched weather for a slate of games. addGame gathers each athlete's stamina, stats and its game's
+// encoded weather into flat arrays, run() applies the stamina and field kernels over the whole slate
+// at once and writes the stamina back. The result is the same as every athlete adapting to a
+// WeatherEffect with its game's stamina impact and field, and that effect being applied once per run():
+// stamina drains again on every run, while the adjusted stats are always the gathered stats with the
+// field penalty taken once. An athlete should appear only once per slate.
+class WeatherPipeline {
+private:
+    GameWorld* world;
+    std::vector<EntityId> athletes;
+    std::vector<EntityId> weatherEffects;
+    std::vector<std::int32_t> staminaImpacts;
+    std::vector<FieldImpacts> fieldImpacts;
+    std::vector<std::int32_t> stamina;
+    std::vector<StatBlock> baseStats; // as gathered, run() never changes them
+    std::vector<StatBlock> stats;     // baseStats weather-adjusted by the last run()
+
+public:
+    explicit WeatherPipeline(GameWorld& world) {
+        this->world = &world;
+    }
+
+    // players all playing in weatherEffect, on a field with fieldImpacts
+    void addGame(const std::vector<Athlete*>& players, const WeatherEffect& weatherEffect, FieldImpacts field) {
+        for (const Athlete* player : players) {
+            athletes.push_back(player->getEntity());
+            weatherEffects.push_back(weatherEffect.getEntity());
+            staminaImpacts.push_back(weatherEffect.getStaminaImpact());
+            fieldImpacts.push_back(field);
+            stamina.push_back(player->getStamina());
+            baseStats.push_back(player->getStats());
+            stats.push_back(player->getStats());
+        }
+    }
+
+    void addGame(const std::vector<Athlete*>& players, const WeatherEffect& weatherEffect) {
+        addGame(players, weatherEffect, weatherEffect.getFieldImpacts());
+    }
+
+    // every player of every team in game, all draining stamina by weatherEffect on the field of the game's
+    // WeatherEvent (weatherEffect's field when the game has none)
+    void addGame(const Game& game, const WeatherEffect& weatherEffect) {
+        const WeatherEvent* weather = game.getWeather();
+        FieldImpacts field = weather != nullptr ? weather->getFieldImpacts() : weatherEffect.getFieldImpacts();
+        for (const Team* team : game.getTeams()) {
+            addGame(team->getPlayers(), weatherEffect, field);
+        }
+    }
+
+    void run() {
+        applyStaminaKernel(stamina.data(), staminaImpacts.data(), stamina.size());
+        stats = baseStats;
+        applyFieldKernel(stats.data(), fieldImpacts.data(), stats.size());
+        for (std::size_t i = 0; i < athletes.size(); i++) {
+            world->weatherModifiers.add(athletes[i], WeatherModifierComponent{ weatherEffects[i], staminaImpacts[i], fieldImpacts[i], stamina[i] });
+        }
+    }
+
+    // Setters and Getters
+    std::size_t getAthleteCount() const { return athletes.size(); }
+    EntityId getAthlete(std::size_t i) const { return athletes[i]; }
+    int getStamina(std::size_t i) const { return stamina[i]; }
+    const StatBlock& getAdjustedStats(std::size_t i) const { return stats[i]; }
+};
+
+// Random stream of one game (SplitMix64). Each game gets its own stream from the season seed and its
+// index in the fixture list, so it plays out the same whichever thread runs it and in whatever order.
+class GameRng {
+private:
+    std::uint64_t state;
+
+public:
+    GameRng(std::uint64_t seed, std::uint64_t stream) {
+        state = seed;
+        state = next() ^ (stream * 0xD1B54A32D192ED03ull);
+    }
+
+    std::uint64_t next() {
+        std::uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    // uniform in 0..bound-1
+    int below(int bound) { return (int)(next() % (std::uint64_t)bound); }
 };
 
+// One game of the schedule, home and away are indexes into the season's teams
+struct Fixture {
+    int week;
+    int home;
+    int away;
+};
+
+// A team's line in the table
+struct Standing {
+    int team; // index into the season's teams
+    int played;
+    int wins;
+    int draws;
+    int losses;
+    int scored;
+    int conceded;
+    int points; // 3 for a win, 1 for a draw
+};
+
+// Class representing a Season: a round-robin schedule of Games between teams, played a week at a time.
+// The games of a week are independent, so they run in parallel on a WorkStealingPool, each one on its own
+// GameRng stream and writing only its own Game. Standings are merged afterwards in fixture order, so the
+// scores and the table are identical for any thread count.
+class Season {
+private:
+    std::vector<Team*> teams;
+    std::vector<WeatherEvent*> weather; // each game draws its weather from these, none means fair weather
+    std::uint64_t seed;
+    std::vector<Fixture> fixtures; // ordered by week
+    std::vector<Game> games;       // games[i] plays fixtures[i]
+    std::vector<std::size_t> weekStart; // fixtures of week w are weekStart[w]..weekStart[w + 1]-1
+    std::vector<Standing> standings; // indexed by team
+    int weeksPlayed;
+
+    static int attack(const StatBlock& stats) {
+        return stats.get(Stat::Speed) + stats.get(Stat::Agility) + stats.get(Stat::Accuracy);
+    }
+
+    static int defence(const StatBlock& stats) {
+        return stats.get(Stat::Strength) + stats.get(Stat::Awareness) + stats.get(Stat::Toughness);
+    }
+
+    void record(Standing& standing, int scored, int conceded) {
+        standing.played++;
+        standing.scored += scored;
+        standing.conceded += conceded;
+        if (scored > conceded) {
+            standing.wins++;
+            standing.points += 3;
+        } else if (scored == conceded) {
+            standing.draws++;
+            standing.points += 1;
+        } else {
+            standing.losses++;
+        }
+    }
+
+public:
+    static const int chancesPerGame = 10;
+
+    // every team plays every other once, or twice (home and away) with homeAndAway
+    Season(std::vector<Team*> teams, std::uint64_t seed, bool homeAndAway = false, std::vector<WeatherEvent*> weather = {}) {
+        this->teams = teams;
+        this->weather = weather;
+        this->seed = seed;
+        fixtures = roundRobin((int)teams.size(), homeAndAway);
+        weekStart.push_back(0);
+        for (std::size_t i = 0; i < fixtures.size(); i++) {
+            while ((int)weekStart.size() <= fixtures[i].week) {
+                weekStart.push_back(i);
+            }
+            // weather uses even streams and play odd ones, so neither depends on the other
+            GameRng rng(seed, 2 * i);
+            WeatherEvent* gameWeather = weather.empty() ? nullptr : weather[rng.below((int)weather.size())];
+            games.push_back(Game("week " + std::to_string(fixtures[i].week + 1), gameWeather,
+                std::vector<Team*>{ teams[fixtures[i].home], teams[fixtures[i].away] }));
+        }
+        weekStart.push_back(fixtures.size());
+        for (int t = 0; t < (int)teams.size(); t++) {
+            standings.push_back(Standing{ t, 0, 0, 0, 0, 0, 0, 0 });
+        }
+        weeksPlayed = 0;
+    }
+
+    // Circle method: team 0 stays put and the others rotate one place a week, so each week everyone plays
+    // once (one team rests when the count is odd). Home and away alternate to keep them balanced.
+    static std::vector<Fixture> roundRobin(int teamCount, bool homeAndAway) {
+        std::vector<Fixture> schedule;
+        int slots = teamCount + teamCount % 2; // the extra slot is the bye
+        std::vector<int> order;
+        for (int t = 0; t < slots; t++) {
+            order.push_back(t);
+        }
+        int weeks = slots - 1;
+        for (int week = 0; week < weeks; week++) {
+            for (int k = 0; k < slots / 2; k++) {
+                int home = order[k];
+                int away = order[slots - 1 - k];
+                if ((week + k) % 2 == 1) {
+                    std::swap(home, away);
+                }
+                if (home < teamCount && away < teamCount) {
+                    schedule.push_back(Fixture{ week, home, away });
+                }
+            }
+            std::rotate(order.begin() + 1, order.end() - 1, order.end());
+        }
+        if (homeAndAway) {
+            std::size_t firstLeg = schedule.size();
+            for (std::size_t i = 0; i < firstLeg; i++) {
+                schedule.push_back(Fixture{ schedule[i].week + weeks, schedule[i].away, schedule[i].home });
+            }
+        }
+        return schedule;
+    }
+
+    // Score of one game. Each side gets chancesPerGame chances, each scoring with a probability set by its
+    // attack against the other side's defence, a small home edge, and the weather's severity.
+    static std::pair<int, int> simulateScore(const StatBlock& home, const StatBlock& away, int severity, GameRng& rng) {
+        int homePercent = std::clamp(30 + 2 * (attack(home) - defence(away)) + 3 - 2 * severity, 5, 90);
+        int awayPercent = std::clamp(30 + 2 * (attack(away) - defence(home)) - 2 * severity, 5, 90);
+        int homeScore = 0;
+        int awayScore = 0;
+        for (int chance = 0; chance < chancesPerGame; chance++) {
+            homeScore += rng.below(100) < homePercent ? 1 : 0;
+            awayScore += rng.below(100) < awayPercent ? 1 : 0;
+        }
+        return std::make_pair(homeScore, awayScore);
+    }
+
+    // plays every game of the next week and adds them to the standings, false once the season is over
+    bool playWeek(WorkStealingPool& pool) {
+        if (weeksPlayed >= getWeekCount()) {
+            return false;
+        }
+        // a team rates as its players' mean when it has players, otherwise as its own stats
+        std::vector<StatBlock> ratings;
+        for (const Team* team : teams) {
+            ratings.push_back(team->getPlayerCount() > 0 ? team->getPlayerRatings() : team->getTeamStats());
+        }
+        std::size_t first = weekStart[weeksPlayed];
+        std::size_t last = weekStart[weeksPlayed + 1];
+        pool.parallel_for(last - first, 64, [&](std::size_t, std::size_t begin, std::size_t end) {
+            for (std::size_t i = first + begin; i < first + end; i++) {
+                GameRng rng(seed, 2 * i + 1);
+                const WeatherEvent* gameWeather = games[i].getWeather();
+                int severity = gameWeather != nullptr ? gameWeather->getSeverity() : 0;
+                std::pair<int, int> score = simulateScore(ratings[fixtures[i].home], ratings[fixtures[i].away], severity, rng);
+                games[i].setScore(score.first, score.second);
+            }
+        });
+        for (std::size_t i = first; i < last; i++) {
+            std::pair<int, int> score = games[i].getScore();
+            record(standings[fixtures[i].home], score.first, score.second);
+            record(standings[fixtures[i].away], score.second, score.first);
+        }
+        weeksPlayed++;
+        return true;
+    }
+
+    void playSeason(WorkStealingPool& pool) {
+        while (playWeek(pool)) {
+        }
+    }
+
+    // the table: points, then goal difference, then goals scored, then team order
+    std::vector<Standing> getStandings() const {
+        std::vector<Standing> table = standings;
+        std::sort(table.begin(), table.end(), [](const Standing& a, const Standing& b) {
+            if (a.points != b.points) {
+                return a.points > b.points;
+            }
+            if (a.scored - a.conceded != b.scored - b.conceded) {
+                return a.scored - a.conceded > b.scored - b.conceded;
+            }
+            if (a.scored != b.scored) {
+                return a.scored > b.scored;
+            }
+            return a.team < b.team;
+        });
+        return table;
+    }
+
+    // Setters and Getters
+    int getWeekCount() const { return (int)weekStart.size() - 1; }
+    int getWeeksPlayed() const { return weeksPlayed; }
+    const std::vector<Fixture>& getFixtures() const { return fixtures; }
+    const std::vector<Game>& getGames() const { return games; }
+    Team* getTeam(int team) const { return teams[team]; }
+};
 
 #endif // GAME_OBJECTS_H
@@ -0,0 +1,354 @@
+// Checks for task3_game_obj.h:
+//   g++ -std=c++17 -O2 -pthread -o game_obj_test task3_game_obj_test.cpp && ./game_obj_test
+// Prints every failed check and exits with 1 when any failed.
+#include "task3_game_obj.h"
+
+#include <memory>
+
+static int checks = 0;
+static int failed = 0;
+
+static void check(bool ok, const std::string& what) {
+    checks++;
+    if (!ok) {
+        failed++;
+        std::cout << "FAILED: " << what << std::endl;
+    }
+}
+
+static StatBlock makeStats(std::uint64_t seed, std::uint64_t stream) {
+    GameRng rng(seed, stream);
+    StatBlock stats;
+    for (int s = 0; s < statCount; s++) {
+        stats.set((Stat)s, 1 + rng.below(10));
+    }
+    return stats;
+}
+
+static void checkComponentArray() {
+    ComponentArray<int> values;
+    for (EntityId e = 0; e < 5; e++) {
+        values.add(e, 10 + (int)e);
+    }
+    values.remove(1); // the last value moves into the hole
+    check(values.size() == 4 && !values.contains(1) && values.get(1) == nullptr, "remove drops the component");
+    check(values.ownerAt(1) == 4 && *values.get(4) == 14 && *values.get(3) == 13, "swap-and-pop moves the last value and its owner");
+    values.remove(3); // the last value, nothing moves
+    values.remove(1); // already gone
+    values.remove(99); // never added
+    check(values.size() == 3 && *values.get(0) == 10 && *values.get(2) == 12 && *values.get(4) == 14, "removing the last or a missing component");
+    values.add(1, 21);
+    values.add(4, 24); // replaces, keeps its position
+    check(values.size() == 4 && values.ownerAt(3) == 1 && *values.get(1) == 21 && values.ownerAt(1) == 4 && *values.get(4) == 24,
+        "add after remove, and add replacing a component");
+}
+
+static void checkOwnedEntity() {
+    GameWorld world;
+    EntityId first;
+    {
+        OwnedEntity owner(world);
+        first = owner;
+        world.stats.add(owner, StatBlock());
+        OwnedEntity moved(std::move(owner));
+        check((EntityId)moved == first && world.stats.contains(first), "moving an entity keeps its components");
+        OwnedEntity other(world);
+        world.stats.add(other, StatBlock());
+        EntityId replaced = other;
+        other = std::move(moved);
+        check((EntityId)other == first && world.stats.contains(first) && !world.stats.contains(replaced),
+            "move assignment destroys the entity it replaces");
+    }
+    check(world.stats.size() == 0, "the last owner destroys the entity");
+    {
+        Reputation reputation(world, 50, 3);
+        Reputation moved(std::move(reputation));
+        check(moved.getReputationScore() == 50 && moved.getEntity() != first, "a handle moves with its entity, ids are not reused");
+    }
+    check(world.reputations.size() == 0, "a handle destroys its components");
+}
+
+static void checkWorldSystems() {
+    GameWorld world;
+    std::vector<std::unique_ptr<Reputation>> reputations;
+    for (int score : { 0, 50, 99, 100 }) {
+        reputations.push_back(std::make_unique<Reputation>(world, score, 1));
+    }
+    world.updateReputations(5);
+    check(reputations[0]->getReputationScore() == 5 && reputations[1]->getReputationScore() == 55
+        && reputations[2]->getReputationScore() == 100 && reputations[3]->getReputationScore() == 100,
+        "updateReputations clamps at the top");
+    world.updateReputations(-60);
+    check(reputations[0]->getReputationScore() == 0 && reputations[1]->getReputationScore() == 0
+        && reputations[2]->getReputationScore() == 40 && reputations[3]->getReputationScore() == 40,
+        "updateReputations clamps at 0");
+
+    WeatherEffect drizzle(world, 30, "wet field", "Rain");
+    WeatherEffect blizzard(world, 70, "icy", "Snow");
+    Athlete wet(world, "wet", "any", StatBlock());
+    Athlete cold(world, "cold", "any", StatBlock());
+    Athlete indoors(world, "indoors", "any", StatBlock());
+    wet.adaptToWeather(&drizzle);
+    cold.adaptToWeather(&blizzard);
+    world.applyWeatherEffects();
+    world.applyWeatherEffects();
+    check(wet.getStamina() == 40 && cold.getStamina() == 0 && indoors.getStamina() == fullStamina,
+        "applyWeatherEffects drains adapted athletes down to 0");
+    world.applyWeatherEffect(drizzle.getEntity());
+    check(wet.getStamina() == 10 && cold.getStamina() == 0, "applyWeatherEffect drains only its own athletes");
+}
+
+// plays the same season on a pool of each thread count and compares every score and the table
+static void checkSeasonThreadCounts() {
+    const int teamCount = 21; // odd, so every week has a bye
+    const int playersPerTeam = 11;
+    GameWorld world;
+    std::vector<std::unique_ptr<Athlete>> athletes;
+    std::vector<std::unique_ptr<Team>> teams;
+    std::vector<Team*> teamPointers;
+    for (int t = 0; t < teamCount; t++) {
+        teams.push_back(std::make_unique<Team>("team " + std::to_string(t), makeStats(7, t)));
+        // every third team has no players and plays on its own stats
+        for (int p = 0; t % 3 != 0 && p < playersPerTeam; p++) {
+            athletes.push_back(std::make_unique<Athlete>(world, "player", "any", makeStats(11, t * playersPerTeam + p)));
+            teams.back()->addPlayer(athletes.back().get());
+        }
+        teamPointers.push_back(teams.back().get());
+    }
+    WeatherEvent rain("Rain", 2, 90, "slippery field");
+    WeatherEvent snow("Snow", 4, 90, "reduced visibility");
+    std::vector<WeatherEvent*> weather{ &rain, &snow };
+
+    Season reference(teamPointers, 2025, true, weather);
+    WorkStealingPool single(1);
+    reference.playSeason(single);
+    check(reference.getWeeksPlayed() == reference.getWeekCount(), "season plays every week");
+
+    for (std::size_t threads : { 2, 3, 8 }) {
+        Season season(teamPointers, 2025, true, weather);
+        WorkStealingPool pool(threads);
+        season.playSeason(pool);
+        std::string label = " with " + std::to_string(threads) + " threads";
+        bool sameScores = season.getGames().size() == reference.getGames().size();
+        for (std::size_t i = 0; sameScores && i < season.getGames().size(); i++) {
+            sameScores = season.getGames()[i].getScore() == reference.getGames()[i].getScore()
+                && season.getGames()[i].getWeather() == reference.getGames()[i].getWeather();
+        }
+        check(sameScores, "same scores and weather" + label);
+        std::vector<Standing> table = season.getStandings();
+        std::vector<Standing> expected = reference.getStandings();
+        bool sameTable = table.size() == expected.size();
+        for (std::size_t i = 0; sameTable && i < table.size(); i++) {
+            sameTable = table[i].team == expected[i].team && table[i].points == expected[i].points
+                && table[i].wins == expected[i].wins && table[i].draws == expected[i].draws
+                && table[i].scored == expected[i].scored && table[i].conceded == expected[i].conceded;
+        }
+        check(sameTable, "same standings" + label);
+    }
+}
+
+static bool sameStats(const StatBlock& a, const StatBlock& b) {
+    for (int s = 0; s < statCount; s++) {
+        if (a.values[s] != b.values[s]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void checkLegacyStats() {
+    std::vector<std::string> rejected;
+    StatBlock stats = parseLegacyStats({ "speed: 9", " Strength :-3  ", "toughness:2147483647", "speed: 9abc", "agility: 9.5",
+        "stamina: 99999999999", "luck: 5", "awareness:", "accuracy 4", "endurance: 7 8" }, &rejected);
+    check(stats.get(Stat::Speed) == 9 && stats.get(Stat::Strength) == -3 && stats.get(Stat::Toughness) == INT32_MAX,
+        "legacy stats with spaces and any case");
+    check(stats.get(Stat::Agility) == 0 && stats.get(Stat::Stamina) == 0 && stats.get(Stat::Endurance) == 0,
+        "rejected entries leave the stat unrated");
+    check(rejected == std::vector<std::string>{ "speed: 9abc", "agility: 9.5", "stamina: 99999999999", "luck: 5",
+        "awareness:", "accuracy 4", "endurance: 7 8" }, "trailing garbage, overflow, unknown names and missing values are rejected");
+    check(parseLegacyStats(formatLegacyStats(stats)).values[(int)Stat::Strength] == -3
+        && formatLegacyStats(stats) == std::vector<std::string>{ "speed: 9", "strength: -3", "toughness: 2147483647" },
+        "legacy stats format back");
+}
+
+static void checkFieldImpacts() {
+    check(parseFieldImpacts("wet and slippery field") == (FieldWet | FieldSlippery), "wet and slippery field");
+    check(parseFieldImpacts("Icy, low visibility") == (FieldFrozen | FieldLowVisibility), "icy, low visibility");
+    check(parseFieldImpacts("Muddy/windy") == (FieldMuddy | FieldWindy), "muddy/windy");
+    check(parseFieldImpacts("nice day") == 0, "nice is not ice");
+    check(parseFieldImpacts("fogged windows, swept pitch") == 0, "only whole words count");
+    check(parseFieldImpacts("") == 0, "empty impact");
+}
+
+// A slate of games through WeatherPipeline against the same athletes in a second world going through
+// adaptToWeather, applyWeatherEffect and getWeatherAdjustedStats, over several runs. The batched games
+// carry their field in a WeatherEvent and their effects only drain stamina, except game 0, which has no
+// WeatherEvent and takes the field from its effect.
+static void checkWeatherPipeline() {
+    const int gameCount = 5;
+    const int playersPerTeam = 7;
+    GameWorld batched;
+    GameWorld perObject;
+    std::vector<std::unique_ptr<WeatherEffect>> batchedEffects;
+    std::vector<std::unique_ptr<WeatherEffect>> perObjectEffects;
+    const char* fields[gameCount] = { "windy", "wet field", "slippery, icy and windy", "muddy with fog", "nice and dry" };
+    std::vector<std::unique_ptr<WeatherEvent>> weather;
+    for (int g = 0; g < gameCount; g++) {
+        weather.push_back(std::make_unique<WeatherEvent>("Rain", 2, 90, fields[g]));
+        batchedEffects.push_back(std::make_unique<WeatherEffect>(batched, 15 * g + 5, g == 0 ? fields[g] : "", "Rain"));
+        perObjectEffects.push_back(std::make_unique<WeatherEffect>(perObject, 15 * g + 5, fields[g], "Rain"));
+    }
+    std::vector<std::unique_ptr<Athlete>> batchedAthletes;
+    std::vector<std::unique_ptr<Athlete>> perObjectAthletes;
+    std::vector<std::unique_ptr<Team>> teams;
+    std::vector<Game> games;
+    for (int g = 0; g < gameCount; g++) {
+        std::vector<Team*> sides;
+        for (int side = 0; side < 2; side++) {
+            teams.push_back(std::make_unique<Team>("team", StatBlock()));
+            for (int p = 0; p < playersPerTeam; p++) {
+                StatBlock stats = makeStats(13, batchedAthletes.size());
+                batchedAthletes.push_back(std::make_unique<Athlete>(batched, "player", "any", stats));
+                perObjectAthletes.push_back(std::make_unique<Athlete>(perObject, "player", "any", stats));
+                teams.back()->addPlayer(batchedAthletes.back().get());
+                perObjectAthletes.back()->adaptToWeather(perObjectEffects[g].get());
+            }
+            sides.push_back(teams.back().get());
+        }
+        games.push_back(Game("week 1", g == 0 ? nullptr : weather[g].get(), sides));
+    }
+    WeatherPipeline pipeline(batched);
+    for (int g = 0; g < gameCount; g++) {
+        pipeline.addGame(games[g], *batchedEffects[g]);
+    }
+    check(pipeline.getAthleteCount() == batchedAthletes.size(), "pipeline gathers every player of every game");
+    for (int run = 1; run <= 3; run++) {
+        pipeline.run();
+        for (const auto& effect : perObjectEffects) {
+            effect->applyWeatherEffect();
+        }
+        bool same = true;
+        for (std::size_t i = 0; same && i < batchedAthletes.size(); i++) {
+            const Athlete& expected = *perObjectAthletes[i];
+            same = pipeline.getAthlete(i) == batchedAthletes[i]->getEntity()
+                && pipeline.getStamina(i) == expected.getStamina()
+                && batchedAthletes[i]->getStamina() == expected.getStamina()
+                && sameStats(pipeline.getAdjustedStats(i), expected.getWeatherAdjustedStats())
+                && sameStats(batchedAthletes[i]->getWeatherAdjustedStats(), expected.getWeatherAdjustedStats());
+        }
+        check(same, "pipeline matches the per-object path after run " + std::to_string(run));
+    }
+}
+
+// mean of every stat over players, summed in 64 bits and rounded half away from zero
+static StatBlock scalarTeamRatings(const std::vector<StatBlock>& players) {
+    StatBlock team;
+    if (players.empty()) {
+        return team;
+    }
+    std::int64_t count = (std::int64_t)players.size();
+    for (int s = 0; s < statCount; s++) {
+        std::int64_t sum = 0;
+        for (const StatBlock& player : players) {
+            sum += player.values[s];
+        }
+        std::int64_t twice = sum * 2;
+        team.values[s] = (std::int32_t)((twice >= 0 ? twice + count : twice - count) / (2 * count));
+    }
+    return team;
+}
+
+static void checkTeamRatings() {
+    for (std::size_t count : { 0, 1, 2, 3, 7, 8, 17, 1000 }) {
+        std::vector<StatBlock> players;
+        for (std::size_t i = 0; i < count; i++) {
+            GameRng rng(31, i);
+            StatBlock stats;
+            for (int s = 0; s < statCount; s++) {
+                stats.set((Stat)s, rng.below(2001) - 1000); // negative ratings round away from zero too
+            }
+            players.push_back(stats);
+        }
+        check(sameStats(aggregateTeamRatings(players.data(), players.size()), scalarTeamRatings(players)),
+            "team ratings of " + std::to_string(count) + " players");
+    }
+    // 65536 players rated 40000 sum past INT32_MAX, which 32 bit lanes would wrap
+    StatBlock high;
+    for (int s = 0; s < statCount; s++) {
+        high.set((Stat)s, s % 2 == 0 ? 40000 : -40000);
+    }
+    std::vector<StatBlock> players(65536, high);
+    StatBlock team = aggregateTeamRatings(players.data(), players.size());
+    check(sameStats(team, high) && sameStats(team, scalarTeamRatings(players)), "team ratings of 65536 players rated 40000");
+}
+
+static bool near(double a, double b, double tolerance) {
+    return std::fabs(a - b) <= tolerance * std::max(1.0, std::fabs(b));
+}
+
+static void checkEngagement() {
+    GameWorld world;
+    SocialMediaAccount account(world, 0.25, "athlete");
+    check(account.getEngagementRate() == 0.25, "seed rate before any interaction");
+    std::vector<std::unique_ptr<Follower>> followers;
+    for (int f = 0; f < 100; f++) {
+        followers.push_back(std::make_unique<Follower>("fan", "casual", 1));
+        account.addFollower(followers.back().get());
+    }
+    check(account.getFollowerCount() == 100, "addFollower counts the follower");
+    account.gainFollowers(100);
+    check(account.getFollowerCount() == 200, "gainFollowers adds to addFollower");
+    account.loseFollowers(100);
+
+    // 50 likes a day spread evenly over 30 days on 100 followers is 0.5 per follower per day
+    const std::int64_t day = 86400;
+    const int likesPerDay = 50;
+    std::int64_t time = 0;
+    for (int i = 0; i < 30 * likesPerDay; i++) {
+        time = 1000000 + i * day / likesPerDay;
+        account.recordInteraction(InteractionKind::Like, time);
+    }
+    check(near(account.getEngagementRate(), 0.5, 0.02), "steady stream rate is in interactions per follower per day");
+    check(account.getEngagementRate() == account.getEngagementRate(time), "no-arg rate is the rate at the latest interaction");
+    check(near(account.getEngagementRate(time + day), account.getEngagementRate() / 2, 1e-12), "rate at now halves a day later");
+
+    // out-of-order events against decaying each one on its own and summing
+    SocialMediaAccount shuffled(world, 0.0, "athlete");
+    shuffled.gainFollowers(10);
+    Post post("video", "today", 0, 0, 0);
+    shuffled.addPost(&post);
+    Follower fan("fan", "casual", 1);
+    double expected[engagementWindowCount][interactionKindCount] = {};
+    const std::int64_t now = 50 * day;
+    for (int i = 0; i < 2000; i++) {
+        GameRng rng(5, i);
+        std::int64_t when = now - rng.below(40 * day);
+        InteractionKind kind = (InteractionKind)rng.below(interactionKindCount);
+        fan.interactWithPost(&post, kind, when);
+        for (int w = 0; w < engagementWindowCount; w++) {
+            expected[w][(int)kind] += std::exp2(-(double)(now - when) / (double)engagementHalfLives[w]);
+        }
+    }
+    check(post.getEngagement() == 2000, "post counts every interaction");
+    bool same = true;
+    for (int w = 0; w < engagementWindowCount; w++) {
+        for (int k = 0; k < interactionKindCount; k++) {
+            same = same && near(shuffled.getDecayedInteractions(w, (InteractionKind)k, now), expected[w][k], 1e-9);
+        }
+    }
+    check(same, "incremental windows match a recount up to rounding");
+}
+
+int main() {
+    checkComponentArray();
+    checkOwnedEntity();
+    checkWorldSystems();
+    checkSeasonThreadCounts();
+    checkLegacyStats();
+    checkFieldImpacts();
+    checkWeatherPipeline();
+    checkTeamRatings();
+    checkEngagement();
+    std::cout << checks << " checks, " << failed << " failed" << std::endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -1,153 +1,3994 @@
 #include <string>
 #include<iostream>
 #include <utility>
+#include <vector>
+#include <memory>
+#include <functional> // for std::hash
+#include <string_view>
+#include <deque>
+#include <span>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <compare>
+#include <charconv>
 #include <climits> // for INT_MAX
+#include <cstdio>
+#include <optional>
+#include <stdexcept>
+#include <filesystem>
+#include <algorithm>
+#include <iterator>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <random>
+#include <streambuf>
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 //Modifed the remove section only.
 //I did not change array to vectors as I wasn't sure I was allowed to do it
 //I may also resubmit the vector version as well.
 
+// Open addressing hash table from item name to slot in the inventory.
+// Only the precomputed hash and the slot are stored, names are checked against the items
+// themselves so the table stays small. Slots can be moved when the array shifts.
+class NameIndex {
+private:
+    static constexpr int EMPTY = -1;
+    static constexpr int DELETED = -2;
+
+    struct Entry {
+        std::size_t hash;
+        int slot;
+    };
+
+    std::vector<Entry> table;
+    int live;  // entries holding a slot
+    int used;  // live entries + tombstones
+
+    std::size_t mask() const {
+        return table.size() - 1;
+    }
+
+    void grow() {
+        std::vector<Entry> old = std::move(table);
+        table.assign(old.empty() ? 16 : old.size() * 2, Entry{ 0, EMPTY });
+        used = live;
+        for (const Entry& e : old) {
+            if (e.slot >= 0) {
+                std::size_t pos = e.hash & mask();
+                while (table[pos].slot != EMPTY) {
+                    pos = (pos + 1) & mask();
+                }
+                table[pos] = e;
+            }
+        }
+    }
+
+    // position of the entry for (hash, slot), or -1
+    long long locate(std::size_t hash, int slot) const {
+        if (table.empty()) {
+            return -1;
+        }
+        std::size_t pos = hash & mask();
+        while (table[pos].slot != EMPTY) {
+            if (table[pos].slot == slot && table[pos].hash == hash) {
+                return (long long)pos;
+            }
+            pos = (pos + 1) & mask();
+        }
+        return -1;
+    }
+
+public:
+    NameIndex() :
+        table{},
+        live{ 0 },
+        used{ 0 } {
+
+    }
+
+    std::size_t memory_bytes() const {
+        return table.capacity() * sizeof(Entry);
+    }
+
+    // returns the slot for which match(slot) is true, or -1 when the name is not indexed
+    template <typename Match>
+    int find(std::size_t hash, Match match) const {
+        if (table.empty()) {
+            return -1;
+        }
+        std::size_t pos = hash & mask();
+        while (table[pos].slot != EMPTY) {
+            if (table[pos].slot >= 0 && table[pos].hash == hash && match(table[pos].slot)) {
+                return table[pos].slot;
+            }
+            pos = (pos + 1) & mask();
+        }
+        return -1;
+    }
+
+    // makes room for n entries so inserting them never has to grow the table
+    void reserve(int n) {
+        while ((used + n) * 10 > (int)table.size() * 7) {
+            grow();
+        }
+    }
+
+    void insert(std::size_t hash, int slot) {
+        // keep the load (tombstones included) under 70% so probes stay short
+        if ((used + 1) * 10 > (int)table.size() * 7) {
+            grow();
+        }
+        std::size_t pos = hash & mask();
+        while (table[pos].slot >= 0) {
+            pos = (pos + 1) & mask();
+        }
+        if (table[pos].slot == EMPTY) {
+            used++;
+        }
+        table[pos] = Entry{ hash, slot };
+        live++;
+    }
+
+    void erase(std::size_t hash, int slot) {
+        long long pos = locate(hash, slot);
+        if (pos >= 0) {
+            table[pos].slot = DELETED;
+            live--;
+        }
+    }
+
+    // the item with this hash moved from old_slot to new_slot
+    void relocate(std::size_t hash, int old_slot, int new_slot) {
+        long long pos = locate(hash, old_slot);
+        if (pos >= 0) {
+            table[pos].slot = new_slot;
+        }
+    }
+};
+
+// Interned item names: every distinct name is stored once and referred to by a dense 32 bit id. A name
+// counts its holders (acquire and release) and is freed with the last one, its id then going to the next
+// new name, so the table holds the names in use rather than every name ever seen. Not thread safe, which
+// is why each owner (an Inventory, a ColumnarInventory, a MappedCatalog) has a table of its own.
+class NameTable {
+private:
+    std::deque<std::string> names; // a deque so references returned by name_of stay valid as it grows
+    std::vector<std::size_t> hashes;
+    std::vector<std::uint32_t> holders; // per id, 0 once the name is freed
+    std::vector<std::uint32_t> free_ids;
+    NameIndex index; // name -> id
+
+public:
+    NameTable() :
+        names{},
+        hashes{},
+        holders{},
+        free_ids{},
+        index{} {
+
+    }
+
+    static std::size_t hash_name(std::string_view name) {
+        return std::hash<std::string_view>{}(name);
+    }
+
+    // id of name, or -1 if nobody holds it
+    int find(std::string_view name, std::size_t hash) const {
+        return index.find(hash, [&](int id) { return names[id] == name; });
+    }
+
+    int find(std::string_view name) const {
+        return find(name, hash_name(name));
+    }
+
+    // id of name, interning it if needed, held until the matching release
+    std::uint32_t acquire(std::string_view name) {
+        std::size_t hash = hash_name(name);
+        int id = find(name, hash);
+        if (id < 0) {
+            if (free_ids.empty()) {
+                id = (int)names.size();
+                names.emplace_back(name);
+                hashes.push_back(hash);
+                holders.push_back(0);
+            }
+            else {
+                id = (int)free_ids.back();
+                free_ids.pop_back();
+                names[id] = name;
+                hashes[id] = hash;
+            }
+            index.insert(hash, id);
+        }
+        holders[id]++;
+        return (std::uint32_t)id;
+    }
+
+    // drops one hold on id, the last one frees the name
+    void release(std::uint32_t id) {
+        if (--holders[id] > 0) {
+            return;
+        }
+        index.erase(hashes[id], (int)id);
+        std::string().swap(names[id]); // gives the characters back too
+        free_ids.push_back(id);
+    }
+
+    // makes room for n more names
+    void reserve(std::size_t n) {
+        hashes.reserve(hashes.size() + n);
+        holders.reserve(holders.size() + n);
+        index.reserve((int)n);
+    }
+
+    const std::string& name_of(std::uint32_t id) const {
+        return names[id];
+    }
+
+    std::size_t hash_of(std::uint32_t id) const {
+        return hashes[id];
+    }
+
+    // names held right now
+    std::size_t size() const {
+        return names.size() - free_ids.size();
+    }
+
+    std::size_t memory_bytes() const {
+        const std::size_t inline_capacity = std::string().capacity();
+        std::size_t bytes = names.size() * sizeof(std::string) + hashes.capacity() * sizeof(std::size_t) + index.memory_bytes()
+            + (holders.capacity() + free_ids.capacity()) * sizeof(std::uint32_t);
+        for (const std::string& name : names) {
+            bytes += name.capacity() > inline_capacity ? name.capacity() + 1 : 0;
+        }
+        return bytes;
+    }
+};
+
+// Prefix and fuzzy search over a set of names, for autocomplete and "did you mean". Names is where an id's
+// name comes from (name_of): a NameTable, or the rows of a snapshot. The owner inserts and erases ids as
+// its names come and go, so a search only walks the names it holds, never everything ever interned. The names are kept as ids sorted by name, which doubles as a
+// compact trie: every node is the range of names sharing a prefix, and its children are found by
+// binary search inside that range, so there are no node allocations. Inserts and erases are queued
+// and applied in one sort and merge at the next search.
+template <typename Names>
+class NameSearch {
+private:
+    const Names& names;
+    std::vector<std::uint32_t> sorted;
+    std::vector<std::pair<std::uint32_t, bool>> pending; // id and whether it was inserted or erased, oldest first
+    std::vector<int> rows; // edit distance rows for similar, one per trie depth
+
+    std::string_view name(std::uint32_t id) const {
+        return names.name_of(id);
+    }
+
+    void queue(std::uint32_t id, bool inserted) {
+        pending.emplace_back(id, inserted);
+        if (pending.size() > sorted.size() + 1024) {
+            refresh(); // keeps the queue in proportion to the index when nobody searches
+        }
+    }
+
+    void refresh() {
+        if (pending.empty()) {
+            return;
+        }
+        // only the last change to each id counts
+        std::stable_sort(pending.begin(), pending.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+        std::vector<std::uint32_t> inserted;
+        std::vector<std::uint32_t> changed; // sorted by id
+        for (std::size_t i = 0; i < pending.size(); i++) {
+            if (i + 1 < pending.size() && pending[i + 1].first == pending[i].first) {
+                continue;
+            }
+            changed.push_back(pending[i].first);
+            if (pending[i].second) {
+                inserted.push_back(pending[i].first);
+            }
+        }
+        pending.clear();
+        // every changed id comes out, even one inserted again: a freed id can come back with another
+        // name, which would sit out of order
+        sorted.erase(std::remove_if(sorted.begin(), sorted.end(), [&](std::uint32_t id) {
+            return std::binary_search(changed.begin(), changed.end(), id);
+        }), sorted.end());
+        auto by_name = [&](std::uint32_t a, std::uint32_t b) { return name(a) < name(b); };
+        std::sort(inserted.begin(), inserted.end(), by_name);
+        std::size_t old_size = sorted.size();
+        sorted.insert(sorted.end(), inserted.begin(), inserted.end());
+        std::inplace_merge(sorted.begin(), sorted.begin() + old_size, sorted.end(), by_name);
+    }
+
+    // Walks the trie node [first, last) at depth, whose edit distance row to query is rows[depth].
+    // Names within max_edits are handed to found(id, distance).
+    template <typename Found>
+    void walk(std::size_t first, std::size_t last, std::size_t depth, std::string_view query, int max_edits, Found& found) {
+        std::size_t width = query.size() + 1;
+        const int* row = rows.data() + depth * width;
+        while (first < last && name(sorted[first]).size() == depth) {
+            // a prefix sorts first, so the names ending here come first (more than one only for snapshot rows)
+            if (row[query.size()] <= max_edits) {
+                found(sorted[first], row[query.size()]);
+            }
+            first++;
+        }
+        if (rows.size() < (depth + 2) * width) {
+            rows.resize((depth + 2) * width);
+            row = rows.data() + depth * width;
+        }
+        int* next = rows.data() + (depth + 1) * width;
+        while (first < last) {
+            char c = name(sorted[first])[depth];
+            std::size_t end = first + 1;
+            if (last - first <= 16) {
+                while (end < last && name(sorted[end])[depth] == c) {
+                    end++; // short runs are cheaper to step over than to bisect
+                }
+            }
+            else {
+                end = std::partition_point(sorted.begin() + first, sorted.begin() + last, [&](std::uint32_t id) {
+                    return name(id)[depth] == c;
+                }) - sorted.begin();
+            }
+
+            // Levenshtein row for the prefix extended by c
+            next[0] = row[0] + 1;
+            int best = next[0];
+            for (std::size_t j = 1; j < width; j++) {
+                next[j] = std::min({ row[j] + 1, next[j - 1] + 1, row[j - 1] + (query[j - 1] != c) });
+                best = std::min(best, next[j]);
+            }
+            if (best <= max_edits) {
+                walk(first, end, depth + 1, query, max_edits, found);
+                row = rows.data() + depth * width; // walk may have grown rows
+                next = rows.data() + (depth + 1) * width;
+            }
+            first = end;
+        }
+    }
+
+public:
+    explicit NameSearch(const Names& names) :
+        names{ names },
+        sorted{},
+        pending{},
+        rows{} {
+    }
+
+    // adds id to the names searched, inserting one already there does nothing
+    void insert(std::uint32_t id) {
+        queue(id, true);
+    }
+
+    // drops id from the names searched
+    void erase(std::uint32_t id) {
+        queue(id, false);
+    }
+
+    // up to limit ids of names starting with prefix, in alphabetical order
+    std::vector<std::uint32_t> with_prefix(std::string_view prefix, std::size_t limit) {
+        refresh();
+        std::vector<std::uint32_t> result;
+        auto it = std::lower_bound(sorted.begin(), sorted.end(), prefix, [&](std::uint32_t id, std::string_view p) {
+            return name(id) < p;
+        });
+        for (; it != sorted.end() && result.size() < limit && name(*it).substr(0, prefix.size()) == prefix; ++it) {
+            result.push_back(*it);
+        }
+        return result;
+    }
+
+    // up to limit ids of names at most max_edits insertions, deletions or substitutions away from query,
+    // each with its distance, closest first
+    std::vector<std::pair<int, std::uint32_t>> similar(std::string_view query, int max_edits, std::size_t limit) {
+        refresh();
+        std::vector<std::pair<int, std::uint32_t>> matches;
+        if (!sorted.empty()) {
+            rows.resize(query.size() + 1);
+            for (std::size_t j = 0; j <= query.size(); j++) {
+                rows[j] = (int)j;
+            }
+            auto found = [&](std::uint32_t id, int distance) {
+                matches.emplace_back(distance, id);
+            };
+            walk(0, sorted.size(), 0, query, max_edits, found);
+        }
+        std::sort(matches.begin(), matches.end(), [&](const auto& a, const auto& b) {
+            return a.first != b.first ? a.first < b.first : name(a.second) < name(b.second);
+        });
+        if (matches.size() > limit) {
+            matches.resize(limit);
+        }
+        return matches;
+    }
+};
+
+// Amount of money in whole cents. Integer arithmetic keeps totals exact however many sales are
+// added up, where a float total drifts after a few million sales.
+class Money {
+private:
+    std::int64_t cents;
+
+    explicit constexpr Money(std::int64_t cents) :
+        cents{ cents } {
+
+    }
+
+public:
+    constexpr Money() :
+        cents{ 0 } {
+
+    }
+
+    static constexpr Money from_cents(std::int64_t cents) {
+        return Money(cents);
+    }
+
+    // rounds to the nearest cent, used for prices typed in or read from a log. Throws
+    // std::invalid_argument for NaN or infinity and std::out_of_range when it does not fit in a Money.
+    static Money from_double(double amount) {
+        if (!std::isfinite(amount)) {
+            throw std::invalid_argument("amount is not a finite number");
+        }
+        double rounded = std::round(amount * 100);
+        if (rounded < -9223372036854775808.0 || rounded >= 9223372036854775808.0) {
+            throw std::out_of_range("amount does not fit in a Money");
+        }
+        return Money((std::int64_t)rounded);
+    }
+
+    std::int64_t get_cents() const {
+        return cents;
+    }
+
+    // throws std::overflow_error when the product does not fit in a Money
+    Money operator*(int quantity) const {
+        // |cents| below 2^32 times |quantity| up to 2^31 always fits, only huge prices need the division
+        std::uint64_t magnitude = cents < 0 ? 0 - (std::uint64_t)cents : (std::uint64_t)cents;
+        std::uint64_t factor = quantity < 0 ? 0 - (std::uint64_t)(std::int64_t)quantity : (std::uint64_t)quantity;
+        if (magnitude >> 32 != 0 && factor != 0 && magnitude > (std::uint64_t)INT64_MAX / factor) {
+            throw std::overflow_error("price * quantity does not fit in a Money");
+        }
+        return Money(cents * quantity);
+    }
+
+    // throws std::overflow_error when the sum does not fit in a Money
+    Money operator+(Money other) const {
+        if (other.cents > 0 ? cents > INT64_MAX - other.cents : cents < INT64_MIN - other.cents) {
+            throw std::overflow_error("sum does not fit in a Money");
+        }
+        return Money(cents + other.cents);
+    }
+
+    // throws std::overflow_error and leaves the amount as it was when the sum does not fit
+    Money& operator+=(Money other) {
+        *this = *this + other;
+        return *this;
+    }
+
+    auto operator<=>(const Money&) const = default;
+
+    // writes the amount as "X.YY" into [first, last) and returns the end, 24 chars always fit
+    char* to_chars(char* first, char* last) const {
+        std::uint64_t magnitude = cents < 0 ? 0 - (std::uint64_t)cents : (std::uint64_t)cents;
+        if (cents < 0) {
+            *first++ = '-';
+        }
+        first = std::to_chars(first, last, magnitude / 100).ptr;
+        *first++ = '.';
+        *first++ = char('0' + magnitude % 100 / 10);
+        *first++ = char('0' + magnitude % 10);
+        return first;
+    }
+
+    friend std::ostream& operator<<(std::ostream& out, Money money) {
+        char text[24];
+        return out << std::string_view(text, money.to_chars(text, text + sizeof(text)));
+    }
+};
+
+// An Item holds its name in the NameTable of its owner, which has to outlive it
 class Item {
 private:
-    std::string name;
+    NameTable* names;
+    std::uint32_t name_id; // symbol in names
+    std::size_t name_hash; // kept so the index never has to look the hash up
     int quantity;
-    float price;
+    Money price;
+
+public:
+    Item(
+        NameTable& names,
+        std::string_view name,
+        int quantity,
+        Money price
+    ) :
+        names{ &names },
+        name_id{ names.acquire(name) },
+        name_hash{ names.hash_of(name_id) },
+        quantity{ quantity },
+        price{ price } {
+
+    }
+
+    Item(const Item&) = delete;
+    Item& operator=(const Item&) = delete;
+
+    ~Item() {
+        names->release(name_id);
+    }
+
+    std::uint32_t get_name_id() const {
+        return name_id;
+    }
+
+    std::size_t get_name_hash() const {
+        return name_hash;
+    }
+
+    const std::string& get_name() const {
+        return names->name_of(name_id);
+    }
+
+    int get_quantity() const {
+        return quantity;
+    }
+
+    void set_quantity(int new_quantity) {
+        quantity = new_quantity;
+    }
+
+    Money get_price() const {
+        return price;
+    }
+
+    bool is_match(const std::string& other) {
+        return get_name() == other;
+    }
+
+    // names are interned, so matching by symbol is an integer compare
+    bool is_match(std::uint32_t other_id) const {
+        return name_id == other_id;
+    }
+};
+
+// Exact 128 bit sum of Money amounts and price * quantity products. Integer addition does not depend
+// on order, so partial sums from any number of threads merge into the same total, and the sum itself
+// cannot overflow: total() says whether the result still fits in a Money.
+class MoneySum {
+private:
+    std::uint64_t low;
+    std::int64_t high;
+
+public:
+    MoneySum() :
+        low{ 0 },
+        high{ 0 } {
+
+    }
+
+    // adds add_high * 2^64 + add_low
+    void add_wide(std::int64_t add_high, std::uint64_t add_low) {
+        std::uint64_t old = low;
+        low += add_low;
+        high += add_high + (low < old ? 1 : 0);
+    }
+
+    void add(std::int64_t cents) {
+        add_wide(cents < 0 ? -1 : 0, (std::uint64_t)cents);
+    }
+
+    void add(Money amount) {
+        add(amount.get_cents());
+    }
+
+    // adds cents * quantity exactly, even when the product does not fit in 64 bits
+    void add_product(std::int64_t cents, int quantity) {
+        // cents = upper * 2^32 + lower with 0 <= lower < 2^32, so both partial products fit in 64 bits
+        std::int64_t upper = cents >> 32;
+        std::int64_t lower = cents & 0xffffffff;
+        add(lower * quantity);
+        std::int64_t shifted = upper * quantity;
+        add_wide(shifted >> 32, (std::uint64_t)shifted << 32);
+    }
+
+    void merge(const MoneySum& other) {
+        add_wide(other.high, other.low);
+    }
+
+    bool fits() const {
+        return high == ((std::int64_t)low < 0 ? -1 : 0);
+    }
+
+    // the exact total, or nothing when it overflowed a Money
+    std::optional<Money> total() const {
+        if (!fits()) {
+            return std::nullopt;
+        }
+        return Money::from_cents((std::int64_t)low);
+    }
+
+    bool operator==(const MoneySum&) const = default;
+};
+
+// Counters kept by every ItemAllocator. heap_calls only counts trips to the global heap,
+// so once a pool is warmed up it should stop moving while allocations keep going up.
+struct AllocationStats {
+    std::size_t allocations;
+    std::size_t deallocations;
+    std::size_t heap_calls;
+};
+
+// Where Inventory gets the memory for its Items. Each call hands out or takes back room for one Item,
+// constructing and destroying the Item is left to Inventory.
+class ItemAllocator {
+protected:
+    AllocationStats counters{};
+
+public:
+    virtual ~ItemAllocator() = default;
+
+    virtual void* allocate() = 0;
+    virtual void deallocate(void* memory) = 0;
+
+    AllocationStats stats() const {
+        return counters;
+    }
+};
+
+// Default allocator, one global new/delete per Item like the original code
+class HeapItemAllocator : public ItemAllocator {
+public:
+    void* allocate() override {
+        counters.allocations++;
+        counters.heap_calls++;
+        return ::operator new(sizeof(Item));
+    }
+
+    void deallocate(void* memory) override {
+        counters.deallocations++;
+        counters.heap_calls++;
+        ::operator delete(memory);
+    }
+};
+
+// Slab allocator: Items are carved out of slabs of slab_size slots and freed slots go on a
+// free list to be handed out again, so steady add/sell churn never reaches the heap.
+class ItemPool : public ItemAllocator {
+private:
+    union Slot {
+        Slot* next;
+        alignas(Item) unsigned char storage[sizeof(Item)];
+    };
+
+    std::vector<std::unique_ptr<Slot[]>> slabs;
+    Slot* free_list;
+    std::size_t slab_size;
+
+    void add_slab() {
+        slabs.push_back(std::make_unique<Slot[]>(slab_size));
+        counters.heap_calls++;
+        Slot* slab = slabs.back().get();
+        for (std::size_t i = 0; i < slab_size; i++) {
+            slab[i].next = free_list;
+            free_list = &slab[i];
+        }
+    }
+
+public:
+    explicit ItemPool(std::size_t slab_size = 1024) :
+        slabs{},
+        free_list{ nullptr },
+        slab_size{ slab_size > 0 ? slab_size : 1 } {
+
+    }
+
+    void* allocate() override {
+        if (free_list == nullptr) {
+            add_slab();
+        }
+        Slot* slot = free_list;
+        free_list = slot->next;
+        counters.allocations++;
+        return slot->storage;
+    }
+
+    void deallocate(void* memory) override {
+        Slot* slot = reinterpret_cast<Slot*>(memory);
+        slot->next = free_list;
+        free_list = slot;
+        counters.deallocations++;
+    }
+};
+
+// How a ChunkedArray grows. Blocks hold block_size slots (rounded up to a power of two).
+// When the array is full, Linear adds one block and Geometric doubles the number of blocks.
+struct GrowthPolicy {
+    enum class Kind { Linear, Geometric };
+
+    std::size_t block_size = 256;
+    Kind kind = Kind::Geometric;
+};
+
+// Growable array made of fixed-size blocks. Growing only adds blocks, existing slots are never
+// moved, so pointers and references to them stay valid however large the array gets.
+template <typename T>
+class ChunkedArray {
+private:
+    std::vector<std::unique_ptr<T[]>> blocks;
+    std::size_t block_shift;
+    std::size_t block_mask;
+    GrowthPolicy::Kind growth;
+
+public:
+    explicit ChunkedArray(GrowthPolicy policy = {}) :
+        blocks{},
+        block_shift{ 0 },
+        block_mask{ 0 },
+        growth{ policy.kind } {
+
+        while (((std::size_t)1 << block_shift) < policy.block_size) {
+            block_shift++;
+        }
+        block_mask = ((std::size_t)1 << block_shift) - 1;
+    }
+
+    T& operator[](std::size_t i) {
+        return blocks[i >> block_shift][i & block_mask];
+    }
+
+    const T& operator[](std::size_t i) const {
+        return blocks[i >> block_shift][i & block_mask];
+    }
+
+    std::size_t capacity() const {
+        return blocks.size() << block_shift;
+    }
+
+    // makes sure slots [0, n) exist, new slots are value initialized
+    void reserve(std::size_t n) {
+        while (capacity() < n) {
+            std::size_t new_blocks = growth == GrowthPolicy::Kind::Geometric && !blocks.empty() ? blocks.size() : 1;
+            for (std::size_t b = 0; b < new_blocks; b++) {
+                blocks.push_back(std::make_unique<T[]>(block_mask + 1));
+            }
+        }
+    }
+
+    std::size_t memory_bytes() const {
+        return capacity() * sizeof(T) + blocks.capacity() * sizeof(blocks[0]);
+    }
+};
+
+// Ordered index from a key (a price in cents or a quantity) to items, for range queries. It is a sorted
+// array with lazy rebuild: insert and erase only append a +1 or -1 entry to an unsorted buffer, and the
+// buffer is sorted and merged into the array (where a -1 cancels the entry it erases) when a query needs
+// the array or the buffer grows past a quarter of it, so updates stay O(1) amortized and queries are two
+// binary searches. The array is rebuilt by queries, so it is mutable.
+class OrderedIndex {
+private:
+    struct Entry {
+        std::int64_t key;
+        const Item* item;
+        int change; // +1 insert, -1 erase, always +1 once merged
+    };
+
+    mutable std::vector<Entry> sorted;
+    mutable std::vector<Entry> pending;
+
+    static bool before(const Entry& a, const Entry& b) {
+        if (a.key != b.key) {
+            return a.key < b.key;
+        }
+        return std::less<const Item*>{}(a.item, b.item);
+    }
+
+    static bool same(const Entry& a, const Entry& b) {
+        return a.key == b.key && a.item == b.item;
+    }
+
+    void push(std::int64_t key, const Item* item, int change) {
+        pending.push_back(Entry{ key, item, change });
+        if (pending.size() >= 1024 + sorted.size() / 4) {
+            settle();
+        }
+    }
+
+    // folds the buffer into the sorted array
+    void settle() const {
+        if (pending.empty()) {
+            return;
+        }
+        std::sort(pending.begin(), pending.end(), before);
+        std::vector<Entry> merged;
+        merged.reserve(sorted.size() + pending.size());
+        std::size_t i = 0;
+        std::size_t j = 0;
+        while (i < sorted.size() || j < pending.size()) {
+            bool from_sorted = j == pending.size() || (i < sorted.size() && !before(pending[j], sorted[i]));
+            Entry next = from_sorted ? sorted[i] : pending[j];
+            // an item can be inserted and erased several times under one key before a merge
+            int count = 0;
+            for (; i < sorted.size() && same(sorted[i], next); i++) {
+                count++;
+            }
+            for (; j < pending.size() && same(pending[j], next); j++) {
+                count += pending[j].change;
+            }
+            if (count > 0) {
+                merged.push_back(Entry{ next.key, next.item, 1 });
+            }
+        }
+        sorted.swap(merged);
+        pending.clear();
+    }
+
+public:
+    // Items with keys in a closed range, in key order. Iterating reads the index in place, and it stays
+    // valid until the inventory changes.
+    class Range {
+    private:
+        const Entry* first;
+        const Entry* last;
+
+    public:
+        class iterator {
+        private:
+            const Entry* entry;
+
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = Item;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const Item*;
+            using reference = const Item&;
+
+            iterator() :
+                entry{ nullptr } {
+
+            }
+
+            explicit iterator(const Entry* entry) :
+                entry{ entry } {
+
+            }
+
+            const Item& operator*() const {
+                return *entry->item;
+            }
+
+            const Item* operator->() const {
+                return entry->item;
+            }
+
+            iterator& operator++() {
+                entry++;
+                return *this;
+            }
+
+            iterator operator++(int) {
+                iterator old = *this;
+                entry++;
+                return old;
+            }
+
+            bool operator==(const iterator& other) const {
+                return entry == other.entry;
+            }
+        };
+
+        Range(const Entry* first, const Entry* last) :
+            first{ first },
+            last{ last } {
+
+        }
+
+        iterator begin() const {
+            return iterator(first);
+        }
+
+        iterator end() const {
+            return iterator(last);
+        }
+
+        std::size_t size() const {
+            return (std::size_t)(last - first);
+        }
+    };
+
+    OrderedIndex() :
+        sorted{},
+        pending{} {
+
+    }
+
+    void insert(std::int64_t key, const Item* item) {
+        push(key, item, 1);
+    }
+
+    // key must be the one item was inserted with
+    void erase(std::int64_t key, const Item* item) {
+        push(key, item, -1);
+    }
+
+    // items with low <= key <= high
+    Range range(std::int64_t low, std::int64_t high) const {
+        settle();
+        auto first = std::lower_bound(sorted.begin(), sorted.end(), low, [](const Entry& e, std::int64_t key) {
+            return e.key < key;
+        });
+        auto last = std::upper_bound(first, sorted.end(), high, [](std::int64_t key, const Entry& e) {
+            return key < e.key;
+        });
+        return Range(sorted.data() + (first - sorted.begin()), sorted.data() + (last - sorted.begin()));
+    }
+
+    std::size_t memory_bytes() const {
+        return (sorted.capacity() + pending.capacity()) * sizeof(Entry);
+    }
+};
+
+// Bytes held by an Inventory, see Inventory::memory_usage
+struct MemoryUsage {
+    std::size_t slots;  // the ChunkedArray of Item pointers
+    std::size_t items;  // the Item objects
+    std::size_t index;  // the name index and the price and quantity indexes
+    std::size_t names;  // the name table
+
+    std::size_t total() const {
+        return slots + items + index + names;
+    }
+};
+
+// One transaction for the programmatic API, see Inventory::apply
+struct Txn {
+    enum class Type : std::uint8_t { Add, Sell };
+
+    Type type;
+    std::string name;
+    int quantity;
+    Money price; // only used by Add
+};
+
+enum class SellStatus { Sold, NotFound, NotEnoughStock, InvalidQuantity };
+
+struct SellResult {
+    SellStatus status;
+    Money money_earned;
+    bool removed; // quantity reached zero and the item was dropped
+};
+
+// What remove does with the slot of an item that sold out
+enum class RemovalMode {
+    Shift,      // shift later items down, keeps listing order, O(n)
+    SwapAndPop, // move the last item into the hole, O(1) but changes listing order
+    Tombstone   // leave an empty slot and compact once half the slots are empty, keeps listing order
+};
+
+// Pushes everything written to file so far down to the disk, so it survives a crash or power loss
+bool flush_to_disk(std::FILE* file) {
+    if (std::fflush(file) != 0) {
+        return false;
+    }
+#if defined(_WIN32)
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+// A rename is only durable once the directory holding it is synced (nothing to do on Windows)
+void sync_directory(const std::string& directory) {
+#if !defined(_WIN32)
+    int fd = open(directory.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+#endif
+}
+
+// Read-only view of a whole file. Mapped where mmap exists, so a large snapshot is paged in as it is
+// read instead of being copied first; on Windows the file is simply read into memory.
+class MappedFile {
+private:
+    const char* bytes;
+    std::size_t length;
+#if defined(_WIN32)
+    std::vector<char> buffer;
+#endif
+
+public:
+    explicit MappedFile(const std::string& path) :
+        bytes{ nullptr },
+        length{ 0 } {
+
+#if defined(_WIN32)
+        std::ifstream in(path, std::ios::binary);
+        if (in) {
+            buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+            bytes = buffer.data();
+            length = buffer.size();
+        }
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return;
+        }
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            void* mapping = mmap(nullptr, (std::size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping != MAP_FAILED) {
+                posix_madvise(mapping, (std::size_t)info.st_size, POSIX_MADV_SEQUENTIAL);
+                bytes = static_cast<const char*>(mapping);
+                length = (std::size_t)info.st_size;
+            }
+        }
+        close(fd); // the mapping stays valid without the descriptor
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+#if !defined(_WIN32)
+        if (bytes != nullptr) {
+            munmap(const_cast<char*>(bytes), length);
+        }
+#endif
+    }
+
+    // false when the file is missing or empty
+    bool is_open() const {
+        return bytes != nullptr;
+    }
+
+    std::span<const char> data() const {
+        return std::span<const char>(bytes, length);
+    }
+};
+
+// Read-only view of one item, for example a snapshot row whose name points into the mapping
+struct ItemView {
+    std::string_view name;
+    int quantity;
+    Money price;
+};
+
+ItemView view_of(const Item& item) {
+    return ItemView{ item.get_name(), item.get_quantity(), item.get_price() };
+}
+
+// Output formats of ItemExporter
+enum class ExportFormat {
+    Text,      // what list_items shows
+    Csv,       // name,quantity,price with a header line
+    JsonLines, // one {"name":...,"quantity":...,"price":...} object per line
+    Binary     // "INVEXP1\n", then int32 quantity, int64 price in cents, uint32 name length, name bytes per item
+};
+
+// Streams items out in one of the ExportFormats. Every item is formatted into a reusable buffer with
+// std::to_chars, and the buffer goes to the stream in large chunks, instead of several formatted
+// stream writes per item.
+class ItemExporter {
+private:
+    static constexpr std::size_t CHUNK = 1 << 16;
+
+    std::ostream& out;
+    ExportFormat format;
+    std::string buffer;
+    std::size_t exported;
+
+    void put(std::string_view text) {
+        buffer.append(text);
+    }
+
+    void put(char c) {
+        buffer.push_back(c);
+    }
+
+    template <typename T>
+    void put_number(T value) {
+        char digits[24];
+        char* end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+        buffer.append(digits, end);
+    }
+
+    void put_money(Money money) {
+        char digits[32];
+        buffer.append(digits, money.to_chars(digits, digits + sizeof(digits)));
+    }
+
+    template <typename T>
+    void put_raw(T value) {
+        buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void put_csv_field(std::string_view text) {
+        if (text.find_first_of(",\"\n\r") == std::string_view::npos) {
+            put(text);
+            return;
+        }
+        put('"');
+        for (char c : text) {
+            if (c == '"') {
+                put('"');
+            }
+            put(c);
+        }
+        put('"');
+    }
+
+    void put_json_string(std::string_view text) {
+        put('"');
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                put('\\');
+                put(c);
+            }
+            else if ((unsigned char)c < 0x20) {
+                const char* hex = "0123456789abcdef";
+                put("\\u00");
+                put(hex[(unsigned char)c >> 4]);
+                put(hex[c & 0xf]);
+            }
+            else {
+                put(c);
+            }
+        }
+        put('"');
+    }
+
+public:
+    ItemExporter(std::ostream& out, ExportFormat format) :
+        out{ out },
+        format{ format },
+        buffer{},
+        exported{ 0 } {
+
+        buffer.reserve(CHUNK + 256);
+        if (format == ExportFormat::Csv) {
+            put("name,quantity,price\n");
+        }
+        else if (format == ExportFormat::Binary) {
+            put("INVEXP1\n");
+        }
+    }
+
+    ItemExporter(const ItemExporter&) = delete;
+    ItemExporter& operator=(const ItemExporter&) = delete;
+
+    ~ItemExporter() {
+        flush();
+    }
+
+    void write(std::string_view name, int quantity, Money price) {
+        switch (format) {
+        case ExportFormat::Text:
+            put("\nItem name: ");
+            put(name);
+            put("\nQuantity: ");
+            put_number(quantity);
+            put("\nPrice: ");
+            put_money(price);
+            put('\n');
+            break;
+
+        case ExportFormat::Csv:
+            put_csv_field(name);
+            put(',');
+            put_number(quantity);
+            put(',');
+            put_money(price);
+            put('\n');
+            break;
+
+        case ExportFormat::JsonLines:
+            put("{\"name\":");
+            put_json_string(name);
+            put(",\"quantity\":");
+            put_number(quantity);
+            put(",\"price\":");
+            put_money(price);
+            put("}\n");
+            break;
+
+        case ExportFormat::Binary:
+            put_raw((std::int32_t)quantity);
+            put_raw((std::int64_t)price.get_cents());
+            put_raw((std::uint32_t)name.size());
+            put(name);
+            break;
+        }
+        exported++;
+        if (buffer.size() >= CHUNK) {
+            flush();
+        }
+    }
+
+    void write(const Item& item) {
+        write(item.get_name(), item.get_quantity(), item.get_price());
+    }
+
+    // hands what is buffered to the stream
+    void flush() {
+        out.write(buffer.data(), (std::streamsize)buffer.size());
+        buffer.clear();
+    }
+
+    std::size_t get_exported() const {
+        return exported;
+    }
+};
+
+// Append-only log of every change made to an Inventory, see InventoryStore. The file starts with the
+// magic "INVWAL1\n" and a uint64 generation, followed by records of
+//     uint8 op, uint32 name length, int32 quantity, int64 price in cents, name bytes, uint32 checksum
+// in native byte order. The checksum covers the rest of the record, so a record torn by a crash is
+// recognised and the log ends just before it.
+// Group commit: append only adds to a buffer, and commit writes the whole group with one write and one
+// fsync. A change is durable once the commit after it returned; commit runs by itself every group_size
+// records, so at most that many changes are lost in a crash.
+// Batches: the records between begin_batch and end_batch are framed by Begin and End records with no
+// name, and scan only hands them out once it has read the End, so a transaction replays whole or not at
+// all even when a group commit or a crash splits it.
+class WriteAheadLog {
+public:
+    enum class Op : std::uint8_t { Add, Sell, Remove, Begin, End };
+
+    struct Record {
+        Op op;
+        std::string_view name; // points into the scanned bytes
+        int quantity;
+        Money price;           // only used by Add
+    };
+
+    static constexpr char MAGIC[8] = { 'I', 'N', 'V', 'W', 'A', 'L', '1', '\n' };
+    static constexpr std::size_t HEADER_SIZE = sizeof(MAGIC) + sizeof(std::uint64_t);
+    static constexpr std::size_t RECORD_SIZE = 1 + 4 + 4 + 8; // before the name and checksum
+
+private:
+    std::FILE* file;
+    std::string buffer;  // records appended since the last commit
+    std::size_t pending; // records in buffer
+    std::size_t group_size;
+    std::uint64_t generation;
+    std::size_t records; // in this generation, committed or not
+
+    // FNV-1a, cheap and good enough to catch a torn or half-written record
+    static std::uint32_t checksum(const char* bytes, std::size_t n) {
+        std::uint32_t hash = 2166136261u;
+        for (std::size_t i = 0; i < n; i++) {
+            hash = (hash ^ (std::uint8_t)bytes[i]) * 16777619u;
+        }
+        return hash;
+    }
+
+    template <typename T>
+    void put(T value) {
+        buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    template <typename T>
+    static T get(const char* bytes) {
+        T value;
+        std::memcpy(&value, bytes, sizeof(value));
+        return value;
+    }
+
+    void close_file() {
+        if (file != nullptr) {
+            commit();
+            std::fclose(file);
+            file = nullptr;
+        }
+    }
+
+public:
+    explicit WriteAheadLog(std::size_t group_size = 256) :
+        file{ nullptr },
+        buffer{},
+        pending{ 0 },
+        group_size{ group_size },
+        generation{ 0 },
+        records{ 0 } {
+
+    }
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    ~WriteAheadLog() {
+        close_file();
+    }
+
+    // generation of the log in bytes, or nothing when they are not a log
+    static std::optional<std::uint64_t> read_generation(std::span<const char> bytes) {
+        if (bytes.size() < HEADER_SIZE || std::memcmp(bytes.data(), MAGIC, sizeof(MAGIC)) != 0) {
+            return std::nullopt;
+        }
+        return get<std::uint64_t>(bytes.data() + sizeof(MAGIC));
+    }
+
+    // calls visit(record) for every intact record outside a batch and every record of a complete batch,
+    // and returns the length of the valid prefix; anything after it is a torn write or a batch whose End
+    // was never written
+    template <typename Visit>
+    static std::size_t scan(std::span<const char> bytes, Visit visit) {
+        std::size_t pos = HEADER_SIZE;
+        std::size_t valid = pos;
+        std::vector<Record> batch;
+        bool in_batch = false;
+        while (bytes.size() - pos >= RECORD_SIZE + 4) {
+            const char* record = bytes.data() + pos;
+            std::uint32_t name_length = get<std::uint32_t>(record + 1);
+            if (name_length > bytes.size() - pos - RECORD_SIZE - 4) {
+                break;
+            }
+            std::size_t size = RECORD_SIZE + name_length;
+            std::uint8_t op = (std::uint8_t)record[0];
+            if (op > (std::uint8_t)Op::End || get<std::uint32_t>(record + size) != checksum(record, size)) {
+                break;
+            }
+            Record decoded{
+                (Op)op,
+                std::string_view(record + RECORD_SIZE, name_length),
+                get<std::int32_t>(record + 5),
+                Money::from_cents(get<std::int64_t>(record + 9))
+            };
+            pos += size + 4;
+            if (decoded.op == Op::Begin) {
+                if (in_batch) {
+                    break; // batches do not nest, the log is damaged
+                }
+                in_batch = true;
+                continue;
+            }
+            if (decoded.op == Op::End) {
+                if (!in_batch) {
+                    break;
+                }
+                for (const Record& held : batch) {
+                    visit(held);
+                }
+                batch.clear();
+                in_batch = false;
+            }
+            else if (in_batch) {
+                batch.push_back(decoded);
+                continue;
+            }
+            else {
+                visit(decoded);
+            }
+            valid = pos;
+        }
+        return valid;
+    }
+
+    // starts an empty log for generation at path, replacing any log there
+    bool create(const std::string& path, std::uint64_t new_generation) {
+        close_file();
+        std::string temporary = path + ".tmp";
+        file = std::fopen(temporary.c_str(), "wb");
+        if (file == nullptr) {
+            return false;
+        }
+        std::fwrite(MAGIC, 1, sizeof(MAGIC), file);
+        std::fwrite(&new_generation, sizeof(new_generation), 1, file);
+        if (!flush_to_disk(file)) {
+            return false;
+        }
+        // swap it in whole so a crash never leaves a log without a header
+        std::error_code error;
+        std::filesystem::rename(temporary, path, error);
+        if (error) {
+            return false;
+        }
+        sync_directory(std::filesystem::path(path).parent_path().string());
+        generation = new_generation;
+        records = 0;
+        return true;
+    }
+
+    // continues the existing log at path, cutting it back to valid_bytes (the end of its last intact record)
+    bool open_append(const std::string& path, std::uint64_t log_generation, std::size_t valid_bytes, std::size_t record_count) {
+        close_file();
+        std::error_code error;
+        std::filesystem::resize_file(path, valid_bytes, error);
+        if (error) {
+            return false;
+        }
+        file = std::fopen(path.c_str(), "ab");
+        generation = log_generation;
+        records = record_count;
+        return file != nullptr;
+    }
+
+    std::uint64_t get_generation() const {
+        return generation;
+    }
+
+    std::size_t get_records() const {
+        return records;
+    }
+
+    void append(Op op, std::string_view name, int quantity, Money price) {
+        std::size_t start = buffer.size();
+        put((std::uint8_t)op);
+        put((std::uint32_t)name.size());
+        put((std::int32_t)quantity);
+        put((std::int64_t)price.get_cents());
+        buffer.append(name);
+        put(checksum(buffer.data() + start, buffer.size() - start));
+        pending++;
+        records++;
+        if (pending >= group_size) {
+            commit();
+        }
+    }
+
+    // the records appended until end_batch replay all together or not at all
+    void begin_batch() {
+        append(Op::Begin, std::string_view(), 0, Money());
+    }
+
+    void end_batch() {
+        append(Op::End, std::string_view(), 0, Money());
+    }
+
+    // makes every appended record durable, false if the disk refused
+    bool commit() {
+        if (pending == 0 || file == nullptr) {
+            return true;
+        }
+        bool written = std::fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+        buffer.clear();
+        pending = 0;
+        return written && flush_to_disk(file);
+    }
+};
+
+// Instrumentation of the Inventory hot paths: latency histograms, hit/miss counters, items moved by
+// removals and Item allocations. It costs a clock read per operation, so it is only compiled in with
+// -DINVENTORY_STATS; otherwise OpTimer and the count_ functions are empty and inventory_stats() is all zeros.
+#if defined(INVENTORY_STATS)
+constexpr bool stats_enabled = true;
+#else
+constexpr bool stats_enabled = false;
+#endif
+
+// Operations timed by the instrumentation
+enum class StatOp {
+    Add,
+    Sell,
+    Remove, // removing an item, whether it sold out or was dropped
+};
+
+constexpr int stat_op_count = 3;
+
+const char* stat_op_name(StatOp op) {
+    switch (op) {
+    case StatOp::Add:
+        return "add";
+    case StatOp::Sell:
+        return "sell";
+    default:
+        return "remove";
+    }
+}
+
+// Latency histogram with HDR-style log-linear buckets: below 32 ns every nanosecond has a bucket, above that
+// every power of two is split into 32 buckets, so a value is known to within about 3% however large it is.
+class LatencyHistogram {
+public:
+    static constexpr int sub_bits = 5;
+    static constexpr int sub_count = 1 << sub_bits;
+    static constexpr int bucket_count = (64 - sub_bits + 1) * sub_count;
+
+    static int bucket_of(std::uint64_t ns) {
+        if (ns < sub_count) {
+            return (int)ns;
+        }
+        int exponent = std::bit_width(ns) - 1;
+        return (exponent - sub_bits + 1) * sub_count + (int)((ns >> (exponent - sub_bits)) & (sub_count - 1));
+    }
+
+    // largest value that falls in bucket
+    static std::uint64_t highest_in(int bucket) {
+        if (bucket < sub_count) {
+            return (std::uint64_t)bucket;
+        }
+        int shift = bucket / sub_count - 1;
+        std::uint64_t lowest = (std::uint64_t)(sub_count + bucket % sub_count) << shift;
+        return lowest + (((std::uint64_t)1 << shift) - 1);
+    }
+
+private:
+    std::array<std::uint64_t, bucket_count> counts{};
+    std::uint64_t count = 0;
+    std::uint64_t max = 0;
+
+public:
+    void record(std::uint64_t ns, std::uint64_t times = 1) {
+        counts[bucket_of(ns)] += times;
+        count += times;
+        max = std::max(max, ns);
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (int i = 0; i < bucket_count; i++) {
+            counts[i] += other.counts[i];
+        }
+        count += other.count;
+        max = std::max(max, other.max);
+    }
+
+    std::uint64_t get_count() const {
+        return count;
+    }
+
+    std::uint64_t get_max() const {
+        return max;
+    }
+
+    // smallest latency that at least fraction (0.99 for p99) of the operations stayed under, 0 when empty
+    std::uint64_t percentile(double fraction) const {
+        if (count == 0) {
+            return 0;
+        }
+        std::uint64_t rank = std::max<std::uint64_t>(1, (std::uint64_t)std::ceil(fraction * (double)count));
+        std::uint64_t seen = 0;
+        for (int i = 0; i < bucket_count; i++) {
+            seen += counts[i];
+            if (seen >= rank) {
+                return std::min(highest_in(i), max);
+            }
+        }
+        return max;
+    }
+};
+
+struct OperationStats {
+    LatencyHistogram latency;
+    std::uint64_t hits = 0;   // lookups that found the item (add does not look anything up)
+    std::uint64_t misses = 0; // lookups that did not
+};
+
+// Snapshot of the instrumentation, summed over every thread, see inventory_stats()
+struct InventoryStats {
+    std::array<OperationStats, stat_op_count> ops;
+    std::uint64_t moved = 0; // items moved to fill the slot of a removed one (shift, swap or compaction)
+    std::uint64_t allocations = 0;
+    std::uint64_t deallocations = 0;
+
+    const OperationStats& operator[](StatOp op) const {
+        return ops[(int)op];
+    }
+};
+
+// Counters of one thread. Only the owning thread writes them, so an update is a relaxed load and store
+// instead of a locked read-modify-write; they are atomic so snapshots can read them from other threads.
+class ThreadStats {
+private:
+    struct Operation {
+        std::array<std::atomic<std::uint64_t>, LatencyHistogram::bucket_count> buckets{};
+        std::atomic<std::uint64_t> hits{ 0 };
+        std::atomic<std::uint64_t> misses{ 0 };
+        std::atomic<std::uint64_t> max{ 0 };
+    };
+
+    std::array<Operation, stat_op_count> ops;
+    std::atomic<std::uint64_t> moved{ 0 };
+    std::atomic<std::uint64_t> allocations{ 0 };
+    std::atomic<std::uint64_t> deallocations{ 0 };
+
+    static void bump(std::atomic<std::uint64_t>& counter, std::uint64_t n = 1) {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+public:
+    void record(StatOp op, std::uint64_t ns) {
+        Operation& operation = ops[(int)op];
+        bump(operation.buckets[LatencyHistogram::bucket_of(ns)]);
+        if (ns > operation.max.load(std::memory_order_relaxed)) {
+            operation.max.store(ns, std::memory_order_relaxed);
+        }
+    }
+
+    void hit(StatOp op) {
+        bump(ops[(int)op].hits);
+    }
+
+    void miss(StatOp op) {
+        bump(ops[(int)op].misses);
+    }
+
+    void count_moved(std::uint64_t n) {
+        bump(moved, n);
+    }
+
+    void count_allocation() {
+        bump(allocations);
+    }
+
+    void count_deallocation() {
+        bump(deallocations);
+    }
+
+    void add_to(InventoryStats& stats) const {
+        for (int op = 0; op < stat_op_count; op++) {
+            const Operation& operation = ops[op];
+            OperationStats& total = stats.ops[op];
+            LatencyHistogram latency;
+            for (int i = 0; i < LatencyHistogram::bucket_count; i++) {
+                std::uint64_t times = operation.buckets[i].load(std::memory_order_relaxed);
+                if (times > 0) {
+                    // the bucket's highest value, except for the max itself, which is kept exactly
+                    latency.record(std::min(LatencyHistogram::highest_in(i), operation.max.load(std::memory_order_relaxed)), times);
+                }
+            }
+            total.latency.merge(latency);
+            total.hits += operation.hits.load(std::memory_order_relaxed);
+            total.misses += operation.misses.load(std::memory_order_relaxed);
+        }
+        stats.moved += moved.load(std::memory_order_relaxed);
+        stats.allocations += allocations.load(std::memory_order_relaxed);
+        stats.deallocations += deallocations.load(std::memory_order_relaxed);
+    }
+};
+
+// Every thread's ThreadStats, plus the totals of threads that already exited
+class StatsRegistry {
+private:
+    std::mutex mutex;
+    std::vector<const ThreadStats*> threads;
+    InventoryStats exited;
+
+public:
+    void enter(const ThreadStats* stats) {
+        std::lock_guard<std::mutex> lock(mutex);
+        threads.push_back(stats);
+    }
+
+    void leave(const ThreadStats* stats) {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats->add_to(exited);
+        threads.erase(std::find(threads.begin(), threads.end(), stats));
+    }
+
+    InventoryStats snapshot() {
+        std::lock_guard<std::mutex> lock(mutex);
+        InventoryStats stats = exited;
+        for (const ThreadStats* thread : threads) {
+            thread->add_to(stats);
+        }
+        return stats;
+    }
+};
+
+StatsRegistry& stats_registry() {
+    static StatsRegistry registry;
+    return registry;
+}
+
+// the calling thread's counters, registered on first use and handed to the registry when the thread exits
+ThreadStats& thread_stats() {
+    struct Registration {
+        ThreadStats stats;
+
+        Registration() {
+            stats_registry().enter(&stats);
+        }
+
+        ~Registration() {
+            stats_registry().leave(&stats);
+        }
+    };
+    thread_local Registration registration;
+    return registration.stats;
+}
+
+// Times one operation, from construction to the end of the scope
+class OpTimer {
+private:
+    StatOp op;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    explicit OpTimer(StatOp op) :
+        op{ op },
+        start{} {
+        if constexpr (stats_enabled) {
+            start = std::chrono::steady_clock::now();
+        }
+    }
+
+    OpTimer(const OpTimer&) = delete;
+    OpTimer& operator=(const OpTimer&) = delete;
+
+    ~OpTimer() {
+        if constexpr (stats_enabled) {
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            thread_stats().record(op, (std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        }
+    }
+};
+
+void count_hit(StatOp op) {
+    if constexpr (stats_enabled) {
+        thread_stats().hit(op);
+    }
+}
+
+void count_miss(StatOp op) {
+    if constexpr (stats_enabled) {
+        thread_stats().miss(op);
+    }
+}
+
+void count_moved(std::uint64_t n) {
+    if constexpr (stats_enabled) {
+        thread_stats().count_moved(n);
+    }
+}
+
+void count_allocation() {
+    if constexpr (stats_enabled) {
+        thread_stats().count_allocation();
+    }
+}
+
+void count_deallocation() {
+    if constexpr (stats_enabled) {
+        thread_stats().count_deallocation();
+    }
+}
+
+// everything recorded so far by every thread
+InventoryStats inventory_stats() {
+    if constexpr (stats_enabled) {
+        return stats_registry().snapshot();
+    }
+    return InventoryStats{};
+}
+
+// one snapshot as a single JSON line, seconds being the time since the dumps started
+void write_stats_json(std::ostream& out, const InventoryStats& stats, double seconds) {
+    out << "{\"seconds\": " << seconds << ", \"moved\": " << stats.moved << ", \"allocations\": " << stats.allocations
+        << ", \"deallocations\": " << stats.deallocations;
+    for (int op = 0; op < stat_op_count; op++) {
+        const OperationStats& operation = stats.ops[op];
+        out << ", \"" << stat_op_name((StatOp)op) << "\": {\"count\": " << operation.latency.get_count()
+            << ", \"hits\": " << operation.hits << ", \"misses\": " << operation.misses
+            << ", \"p50_ns\": " << operation.latency.percentile(0.5) << ", \"p99_ns\": " << operation.latency.percentile(0.99)
+            << ", \"p999_ns\": " << operation.latency.percentile(0.999) << ", \"max_ns\": " << operation.latency.get_max() << "}";
+    }
+    out << "}\n";
+}
+
+// Appends a snapshot to out every interval from a background thread, and a last one when it goes away.
+// The snapshots are cumulative, so the last line covers the whole run.
+class StatsDumper {
+private:
+    std::ostream& out;
+    std::chrono::milliseconds interval;
+    std::chrono::steady_clock::time_point start;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping;
+    std::thread thread;
+
+    void dump() {
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        write_stats_json(out, inventory_stats(), seconds);
+        out.flush();
+    }
+
+public:
+    StatsDumper(std::ostream& out, std::chrono::milliseconds interval) :
+        out{ out },
+        interval{ interval },
+        start{ std::chrono::steady_clock::now() },
+        mutex{},
+        wake{},
+        stopping{ false },
+        thread{} {
+        thread = std::thread([this] {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!wake.wait_for(lock, this->interval, [this] { return stopping; })) {
+                dump();
+            }
+        });
+    }
+
+    StatsDumper(const StatsDumper&) = delete;
+    StatsDumper& operator=(const StatsDumper&) = delete;
+
+    ~StatsDumper() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        thread.join();
+        dump();
+    }
+};
+
+// Snapshot of an InventoryStore. It is laid out to be used straight from a mapping: a fixed header, then
+// one fixed-size record per item, then all names back to back. Records point into the names with an
+// offset, so nothing has to be parsed or copied to read an item.
+struct SnapshotHeader {
+    char magic[8];
+    std::uint64_t generation; // the log generation that continues from this snapshot
+    std::uint64_t item_count;
+    std::int64_t total_money_cents;
+    std::uint64_t names_bytes;
+};
+
+struct SnapshotItem {
+    std::int64_t price_cents;
+    std::uint64_t name_offset; // into the names that follow the records
+    std::uint32_t name_length;
+    std::int32_t quantity;
+};
+
+constexpr char SNAPSHOT_MAGIC[8] = { 'I', 'N', 'V', 'S', 'N', 'P', '1', '\n' };
+
+// A mapped snapshot file. Opening checks the header and that every record's name lies inside the
+// names, after that item(i) is a couple of loads from the mapping.
+class SnapshotFile {
+private:
+    MappedFile file;
+    SnapshotHeader header;
+    const char* records;
+    const char* names;
+    bool valid;
+
+    SnapshotItem record(std::size_t i) const {
+        SnapshotItem r;
+        std::memcpy(&r, records + i * sizeof(SnapshotItem), sizeof(r));
+        return r;
+    }
+
+public:
+    explicit SnapshotFile(const std::string& path) :
+        file{ path },
+        header{},
+        records{ nullptr },
+        names{ nullptr },
+        valid{ false } {
+
+        std::span<const char> bytes = file.data();
+        if (bytes.size() < sizeof(header)) {
+            return;
+        }
+        std::memcpy(&header, bytes.data(), sizeof(header));
+        std::size_t records_bytes = header.item_count * sizeof(SnapshotItem);
+        if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0
+            || header.item_count > bytes.size() / sizeof(SnapshotItem)
+            || bytes.size() != sizeof(header) + records_bytes + header.names_bytes) {
+            return;
+        }
+
+        records = bytes.data() + sizeof(header);
+        names = records + records_bytes;
+        for (std::size_t i = 0; i < header.item_count; i++) {
+            SnapshotItem r = record(i);
+            if (r.name_offset > header.names_bytes || r.name_length > header.names_bytes - r.name_offset) {
+                return;
+            }
+        }
+        valid = true;
+    }
+
+    // false when the file is missing or empty
+    bool is_open() const {
+        return file.is_open();
+    }
+
+    // false when the file is not a snapshot or is damaged
+    bool is_valid() const {
+        return valid;
+    }
+
+    std::size_t size() const {
+        return valid ? header.item_count : 0;
+    }
+
+    std::uint64_t get_generation() const {
+        return header.generation;
+    }
+
+    Money get_total_money() const {
+        return Money::from_cents(header.total_money_cents);
+    }
+
+    ItemView item(std::size_t i) const {
+        SnapshotItem r = record(i);
+        return ItemView{ std::string_view(names + r.name_offset, r.name_length), r.quantity, Money::from_cents(r.price_cents) };
+    }
+
+    // name of row i, for a NameSearch over the rows
+    std::string_view name_of(std::uint32_t i) const {
+        return item(i).name;
+    }
+};
+
+class Inventory {
+private:
+    NameTable names; // names of the items here, declared first so it outlives them
+    ChunkedArray<Item*> items;  // grows block by block, so an Item* slot never moves when more items are added
+    Money total_money;
+    int item_count;  // slots in use, including tombstones
+    int tombstones;  // empty slots left behind in RemovalMode::Tombstone
+    RemovalMode removal_mode;
+    NameIndex index; // name -> slot in items, kept in sync by add, remove and compact
+    mutable NameSearch<NameTable> search; // names with at least one item here, kept in sync with index
+    OrderedIndex by_price;    // price in cents -> items, for range queries
+    OrderedIndex by_quantity; // quantity -> items, kept in sync by set_quantity
+    HeapItemAllocator heap;
+    ItemAllocator* allocator; // where Items are allocated, heap unless one is plugged in
+    WriteAheadLog* wal; // every change is appended here while a log is attached, see InventoryStore
+    // Rows of the snapshot the inventory was loaded from (see load_snapshot), served straight from the
+    // mapping. A row is copied into an Item the first time a change reaches it (copy on write), and is
+    // listed after the rows still in the snapshot from then on.
+    std::unique_ptr<SnapshotFile> snapshot;
+    std::vector<bool> loaded; // rows copied into Items, sized on the first copy
+    int loaded_rows;
+    mutable NameIndex row_index; // name -> row, built on the first lookup by name
+    mutable bool rows_indexed;
+    mutable std::optional<NameSearch<SnapshotFile>> row_search; // names of the rows still in the snapshot, built on the first search
+
+    // One change made inside a transaction, see begin. Entries are undone newest first, so each only has to
+    // take the inventory back from just after its change to just before it.
+    struct Undo {
+        enum class Kind : std::uint8_t { Added, Loaded, Removed, Quantity };
+        Kind kind;
+        int slot;     // Removed: the slot the item was removed from, Loaded: the snapshot row
+        int quantity; // Quantity: the quantity before
+        Item* item;   // Quantity: the item changed
+        Money money;  // Quantity: total_money before
+    };
+    // log record of an open transaction, the item is alive until the transaction ends
+    struct HeldRecord {
+        WriteAheadLog::Op op;
+        const Item* item;
+        int quantity;
+        Money price;
+    };
+    struct Savepoint {
+        std::size_t undo; // undo_log and held sizes at begin
+        std::size_t held;
+    };
+    std::vector<Undo> undo_log;
+    std::vector<Item*> retired;     // removed inside the transaction, kept so a rollback can put them back
+    std::vector<HeldRecord> held;   // log records of the transaction, appended to wal by the outermost commit
+    std::vector<Savepoint> savepoints;
+    // What the last rollback undid, for redo: its entries oldest first (a Quantity entry holds the quantity
+    // and total_money after the change), the Items it took back out and its log records. Only valid while
+    // changes is still redo_changes.
+    std::vector<Undo> redo_log;
+    std::vector<Item*> undone;      // added by the rolled back changes, the first one added last
+    std::vector<HeldRecord> redo_held;
+    std::uint64_t changes;          // counts every change, so redo can tell the inventory moved on
+    std::uint64_t redo_changes;
+
+    void destroy(Item* item) {
+        item->~Item();
+        allocator->deallocate(item);
+        count_deallocation();
+    }
+
+    // index an item at slot, its name becomes searchable with the first item carrying it
+    void index_item(const Item* item, int slot) {
+        if (find(item->get_name_id()) < 0) {
+            search.insert(item->get_name_id());
+        }
+        index.insert(item->get_name_hash(), slot);
+    }
+
+    // the reverse of index_item, the name stops being searchable with the last item carrying it
+    void unindex_item(const Item* item, int slot) {
+        index.erase(item->get_name_hash(), slot);
+        if (find(item->get_name_id()) < 0) {
+            search.erase(item->get_name_id());
+        }
+    }
+
+    void forget_redo() {
+        for (Item* item : undone) {
+            destroy(item);
+        }
+        undone.clear();
+        redo_log.clear();
+        redo_held.clear();
+    }
+
+    // puts item in the next slot and indexes it, the slot must be reserved; row is the snapshot row it was
+    // copied from, if any
+    void push_item(Item* item, int row = -1) {
+        items[item_count] = item;
+        index_item(item, item_count);
+        by_price.insert(item->get_price().get_cents(), item);
+        by_quantity.insert(item->get_quantity(), item);
+        item_count++;
+        changes++;
+        if (!savepoints.empty()) {
+            undo_log.push_back(Undo{ row < 0 ? Undo::Kind::Added : Undo::Kind::Loaded, row, 0, nullptr, Money() });
+        }
+    }
+
+    void set_quantity(Item* item, int quantity) {
+        changes++;
+        if (!savepoints.empty()) {
+            undo_log.push_back(Undo{ Undo::Kind::Quantity, 0, item->get_quantity(), item, total_money });
+        }
+        by_quantity.erase(item->get_quantity(), item);
+        item->set_quantity(quantity);
+        by_quantity.insert(quantity, item);
+    }
+
+    // appends to wal, or holds the record back until the outermost commit while a transaction is open
+    void log(WriteAheadLog::Op op, const Item& item, int quantity, Money price) {
+        if (wal == nullptr) {
+            return;
+        }
+        if (savepoints.empty()) {
+            wal->append(op, item.get_name(), quantity, price);
+        }
+        else {
+            held.push_back(HeldRecord{ op, &item, quantity, price });
+        }
+    }
+
+    // slot of the item called name, or -1
+    int find(const std::string& name) const {
+        // hash lookup instead of comparing the name against every item, the string is only
+        // compared once in the name table and the index then just compares ids
+        int id = names.find(name);
+        if (id < 0) {
+            return -1; // not stocked here
+        }
+        return find((std::uint32_t)id);
+    }
+
+    int find(std::uint32_t symbol) const {
+        return index.find(names.hash_of(symbol), [&](int i) { return items[i]->is_match(symbol); });
+    }
+
+    int snapshot_rows() const {
+        return snapshot ? (int)snapshot->size() : 0;
+    }
+
+    bool is_loaded(int row) const {
+        return !loaded.empty() && loaded[row];
+    }
+
+    // snapshot row of the item called name that is still served from the mapping, or -1
+    int find_row(const std::string& name) const {
+        if (!snapshot) {
+            return -1;
+        }
+        if (!rows_indexed) {
+            row_index.reserve(snapshot_rows());
+            for (int row = 0; row < snapshot_rows(); row++) {
+                row_index.insert(NameTable::hash_name(snapshot->item(row).name), row);
+            }
+            rows_indexed = true;
+        }
+        // copied rows stay in row_index and are skipped here
+        return row_index.find(NameTable::hash_name(name), [&](int row) {
+            return !is_loaded(row) && snapshot->item(row).name == name;
+        });
+    }
+
+    NameSearch<SnapshotFile>& rows_search() const {
+        if (!row_search) {
+            row_search.emplace(*snapshot);
+            for (int row = 0; row < snapshot_rows(); row++) {
+                if (!is_loaded(row)) {
+                    row_search->insert(row);
+                }
+            }
+        }
+        return *row_search;
+    }
+
+    void set_loaded(int row, bool value) {
+        if (loaded.empty()) {
+            loaded.resize(snapshot_rows());
+        }
+        loaded[row] = value;
+        loaded_rows += value ? 1 : -1;
+        if (row_search) {
+            if (value) {
+                row_search->erase(row);
+            }
+            else {
+                row_search->insert(row);
+            }
+        }
+    }
+
+    Item* copy_row(int row) {
+        ItemView view = snapshot->item(row);
+        Item* item = new (allocator->allocate()) Item(names, view.name, view.quantity, view.price);
+        count_allocation();
+        set_loaded(row, true);
+        return item;
+    }
+
+    // copies a snapshot row into an Item in the next slot, just before it changes, and returns the slot
+    int load_row(int row) {
+        items.reserve(item_count + 1);
+        push_item(copy_row(row), row);
+        return item_count - 1;
+    }
+
+    // slot of the item called name for a change, copying it out of the snapshot if it is still there
+    int find_for_change(const std::string& name) {
+        int slot = find(name);
+        if (slot < 0) {
+            int row = find_row(name);
+            if (row >= 0) {
+                slot = load_row(row);
+            }
+        }
+        return slot;
+    }
+
+    // Copies every row still in the snapshot, for the queries only Items answer. The copies go in the
+    // slots in front of the items, where the rows are listed, so listing order is kept. That is not a
+    // change: nothing is logged and a rollback leaves the copies, it only shifts the slots the undo and
+    // redo logs hold.
+    void load_rows() {
+        int count = snapshot_rows() - loaded_rows;
+        if (count == 0) {
+            return;
+        }
+        items.reserve(item_count + count);
+        // from the back, so no slot is taken while it is being moved into
+        for (int i = item_count - 1; i >= 0; i--) {
+            items[i + count] = items[i];
+            if (items[i] != nullptr) {
+                index.relocate(items[i]->get_name_hash(), i, i + count);
+            }
+        }
+        item_count += count;
+        int slot = 0;
+        for (int row = 0; row < snapshot_rows(); row++) {
+            if (!is_loaded(row)) {
+                Item* item = copy_row(row);
+                items[slot] = item;
+                index_item(item, slot);
+                by_price.insert(item->get_price().get_cents(), item);
+                by_quantity.insert(item->get_quantity(), item);
+                slot++;
+            }
+        }
+        for (std::vector<Undo>* log : { &undo_log, &redo_log }) {
+            for (Undo& entry : *log) {
+                if (entry.kind == Undo::Kind::Removed) {
+                    entry.slot += count;
+                }
+            }
+        }
+    }
+
+    std::vector<std::string> names_of(const std::vector<std::uint32_t>& ids) const {
+        std::vector<std::string> result;
+        for (std::uint32_t id : ids) {
+            result.push_back(names.name_of(id));
+        }
+        return result;
+    }
+
+    SellResult sell_at(int item_index, int input_quantity) {
+        Item* item = items[item_index];
+        int quantity = item->get_quantity();
+        if (input_quantity <= 0) {
+            return SellResult{ SellStatus::InvalidQuantity, Money(), false };
+        }
+        if (input_quantity > quantity) {
+            return SellResult{ SellStatus::NotEnoughStock, Money(), false };
+        }
+
+        Money price = item->get_price();
+        Money money_earned = price * input_quantity;
+        Money new_total = total_money + money_earned; // both may throw, so before anything changes
+        set_quantity(item, quantity - input_quantity);
+        total_money = new_total;
+        log(WriteAheadLog::Op::Sell, *item, input_quantity, Money());
+
+        bool removed = item->get_quantity() == 0;
+        if (removed) {
+            remove(item_index);
+        }
+        return SellResult{ SellStatus::Sold, money_earned, removed };
+    }
+
+    //Modifed and Updated code here:
+    // the quantity reached zero, delete the item and free its slot according to removal_mode
+    void remove(int item_index) {
+        OpTimer timer(StatOp::Remove);
+        Item* item = items[item_index];
+        changes++;
+        unindex_item(item, item_index);
+        by_price.erase(item->get_price().get_cents(), item);
+        by_quantity.erase(item->get_quantity(), item);
+        if (savepoints.empty()) {
+            destroy(item); // free the memory of item
+        }
+        else {
+            retired.push_back(item);
+            undo_log.push_back(Undo{ Undo::Kind::Removed, item_index, 0, nullptr, Money() });
+        }
+
+        if (removal_mode == RemovalMode::SwapAndPop) {
+            int last = item_count - 1;
+            if (item_index != last) {
+                items[item_index] = items[last];
+                index.relocate(items[item_index]->get_name_hash(), last, item_index);
+                count_moved(1);
+            }
+            items[last] = nullptr;
+            item_count--;
+            return;
+        }
+
+        if (removal_mode == RemovalMode::Tombstone) {
+            items[item_index] = nullptr;
+            tombstones++;
+            if (tombstones * 2 >= item_count && savepoints.empty()) { // compacting would move the slots undo_log refers to
+                compact();
+            }
+            return;
+        }
+
+        // Shift items in array to fill the empty spaces (shifted spaces)
+        count_moved(item_count - 1 - item_index);
+        for (int i = item_index; i < item_count - 1; i++) {
+            items[i] = items[i + 1];
+            index.relocate(items[i]->get_name_hash(), i + 1, i); // keep the index pointing at the new slot
+        }
+        items[item_count - 1] = nullptr; // set last item to nullptr
+        item_count--; // decrease item count
+    }
+
+    // squeeze out the tombstones in one pass, keeping the order of the remaining items
+    void compact() {
+        changes++;
+        int live = 0;
+        for (int i = 0; i < item_count; i++) {
+            if (items[i] == nullptr) {
+                continue;
+            }
+            if (i != live) {
+                items[live] = items[i];
+                items[i] = nullptr;
+                index.relocate(items[live]->get_name_hash(), i, live);
+                count_moved(1);
+            }
+            live++;
+        }
+        item_count = live;
+        tombstones = 0;
+    }
+
+    // reverts entry, the inventory being as it was right after that change
+    void undo(const Undo& entry) {
+        if (entry.kind == Undo::Kind::Quantity) {
+            by_quantity.erase(entry.item->get_quantity(), entry.item);
+            entry.item->set_quantity(entry.quantity);
+            by_quantity.insert(entry.quantity, entry.item);
+            total_money = entry.money;
+            return;
+        }
+
+        if (entry.kind == Undo::Kind::Added || entry.kind == Undo::Kind::Loaded) {
+            // added and copied items always go in the last slot
+            int last = item_count - 1;
+            Item* item = items[last];
+            unindex_item(item, last);
+            by_price.erase(item->get_price().get_cents(), item);
+            by_quantity.erase(item->get_quantity(), item);
+            items[last] = nullptr;
+            item_count--;
+            undone.push_back(item); // for redo
+            if (entry.kind == Undo::Kind::Loaded) {
+                set_loaded(entry.slot, false); // served from the snapshot again
+            }
+            return;
+        }
+
+        Item* item = retired.back();
+        retired.pop_back();
+        int slot = entry.slot;
+        if (removal_mode == RemovalMode::Tombstone) {
+            tombstones--;
+        }
+        else {
+            items.reserve(item_count + 1);
+            if (removal_mode == RemovalMode::SwapAndPop) {
+                if (slot < item_count) { // the last item was moved into the slot, move it back
+                    items[item_count] = items[slot];
+                    index.relocate(items[item_count]->get_name_hash(), slot, item_count);
+                }
+            }
+            else {
+                for (int i = item_count; i > slot; i--) {
+                    items[i] = items[i - 1];
+                    index.relocate(items[i]->get_name_hash(), i - 1, i);
+                }
+            }
+            item_count++;
+        }
+        items[slot] = item;
+        index_item(item, slot);
+        by_price.insert(item->get_price().get_cents(), item);
+        by_quantity.insert(item->get_quantity(), item);
+    }
+
+public:
+    // allocator, when given, must outlive the Inventory
+    explicit Inventory(
+        RemovalMode removal_mode = RemovalMode::Shift,
+        GrowthPolicy growth = {},
+        ItemAllocator* allocator = nullptr
+    ) :
+        names{},
+        items{ growth },
+        total_money{},
+        item_count{ 0 },
+        tombstones{ 0 },
+        removal_mode{ removal_mode },
+        index{},
+        search{ names },
+        by_price{},
+        by_quantity{},
+        heap{},
+        allocator{ allocator != nullptr ? allocator : &heap },
+        wal{ nullptr },
+        snapshot{},
+        loaded{},
+        loaded_rows{ 0 },
+        row_index{},
+        rows_indexed{ false },
+        row_search{},
+        undo_log{},
+        retired{},
+        held{},
+        savepoints{},
+        redo_log{},
+        undone{},
+        redo_held{},
+        changes{ 0 },
+        redo_changes{ 0 } {
+
+    }
+
+    Inventory(const Inventory&) = delete;
+    Inventory& operator=(const Inventory&) = delete;
+
+    ~Inventory() {
+        for (int i = 0; i < item_count; i++) {
+            if (items[i] != nullptr) {
+                destroy(items[i]);
+            }
+        }
+        for (Item* item : retired) {
+            destroy(item);
+        }
+        forget_redo();
+    }
+
+    // Programmatic API, used by the menu below and by --replay
+
+    void add(std::string_view name, int quantity, Money price) {
+        OpTimer timer(StatOp::Add);
+        items.reserve(item_count + 1);
+        Item* item = new (allocator->allocate()) Item(names, name, quantity, price);
+        count_allocation();
+        push_item(item);
+        log(WriteAheadLog::Op::Add, *item, quantity, price);
+    }
+
+    SellResult sell(const std::string& name, int quantity) {
+        OpTimer timer(StatOp::Sell);
+        int slot = find(name);
+        int row = slot < 0 ? find_row(name) : -1;
+        if (slot < 0 && row < 0) {
+            count_miss(StatOp::Sell);
+            return SellResult{ SellStatus::NotFound, Money(), false };
+        }
+        count_hit(StatOp::Sell);
+        if (row >= 0) {
+            // a sale that fails leaves the row in the snapshot
+            ItemView item = snapshot->item(row);
+            if (quantity <= 0 || quantity > item.quantity) {
+                return SellResult{ quantity <= 0 ? SellStatus::InvalidQuantity : SellStatus::NotEnoughStock, Money(), false };
+            }
+            (void)(total_money + item.price * quantity); // throws std::overflow_error before the row is copied
+            slot = load_row(row);
+        }
+        return sell_at(slot, quantity);
+    }
+
+    // drops the item whatever stock is left, false if there is no such item
+    bool remove(const std::string& name) {
+        int slot = find_for_change(name);
+        if (slot < 0) {
+            count_miss(StatOp::Remove);
+            return false;
+        }
+        count_hit(StatOp::Remove);
+        log(WriteAheadLog::Op::Remove, *items[slot], 0, Money());
+        remove(slot);
+        return true;
+    }
+
+    // Starts a transaction, or a savepoint inside the open one. Until the matching commit or rollback every
+    // change goes into an undo log, one small entry per change (removed Items are kept instead of freed),
+    // so a transaction costs in proportion to what it touches and never copies the inventory.
+    void begin() {
+        savepoints.push_back(Savepoint{ undo_log.size(), held.size() });
+    }
+
+    // Keeps the changes since the matching begin. Ending a savepoint hands its changes to the enclosing
+    // transaction; ending the outermost one logs them as one batch (see WriteAheadLog) and frees the Items
+    // it removed.
+    void commit() {
+        if (savepoints.empty()) {
+            return;
+        }
+        savepoints.pop_back();
+        if (!savepoints.empty()) {
+            return;
+        }
+        if (wal != nullptr && !held.empty()) {
+            wal->begin_batch();
+            for (const HeldRecord& record : held) {
+                wal->append(record.op, record.item->get_name(), record.quantity, record.price);
+            }
+            wal->end_batch();
+        }
+        held.clear();
+        for (Item* item : retired) {
+            destroy(item);
+        }
+        retired.clear();
+        undo_log.clear();
+        if (removal_mode == RemovalMode::Tombstone && tombstones * 2 >= item_count) {
+            compact(); // put off while the transaction was open
+        }
+    }
+
+    // Undoes every change since the matching begin, newest first: stock, money, slots and listing order
+    // all go back to how they were, and none of the changes reach the log.
+    void rollback() {
+        if (savepoints.empty()) {
+            return;
+        }
+        Savepoint savepoint = savepoints.back();
+        savepoints.pop_back();
+        forget_redo();
+        while (undo_log.size() > savepoint.undo) {
+            const Undo& entry = undo_log.back();
+            if (entry.kind == Undo::Kind::Quantity) {
+                redo_log.push_back(Undo{ entry.kind, 0, entry.item->get_quantity(), entry.item, total_money });
+            }
+            else {
+                redo_log.push_back(entry);
+            }
+            undo(entry);
+            undo_log.pop_back();
+        }
+        std::reverse(redo_log.begin(), redo_log.end());
+        redo_held.assign(held.begin() + (std::ptrdiff_t)savepoint.held, held.end());
+        held.erase(held.begin() + (std::ptrdiff_t)savepoint.held, held.end());
+        redo_changes = changes;
+    }
+
+    // Commits every change made before the innermost savepoint began and makes that savepoint the
+    // outermost transaction, with its own changes still open. The menu keeps only its latest change
+    // undoable this way.
+    void commit_outer() {
+        if (savepoints.size() < 2) {
+            return;
+        }
+        Savepoint inner = savepoints.back();
+        savepoints.assign(1, Savepoint{ 0, 0 });
+        if (wal != nullptr && inner.held > 0) {
+            wal->begin_batch();
+            for (std::size_t i = 0; i < inner.held; i++) {
+                wal->append(held[i].op, held[i].item->get_name(), held[i].quantity, held[i].price);
+            }
+            wal->end_batch();
+        }
+        held.erase(held.begin(), held.begin() + (std::ptrdiff_t)inner.held);
+        // one Item was retired per Removed entry, in the same order
+        std::ptrdiff_t removed = std::count_if(undo_log.begin(), undo_log.begin() + (std::ptrdiff_t)inner.undo,
+            [](const Undo& entry) { return entry.kind == Undo::Kind::Removed; });
+        for (std::ptrdiff_t i = 0; i < removed; i++) {
+            destroy(retired[i]);
+        }
+        retired.erase(retired.begin(), retired.begin() + removed);
+        undo_log.erase(undo_log.begin(), undo_log.begin() + (std::ptrdiff_t)inner.undo);
+    }
+
+    // whether the innermost savepoint changed anything yet, false outside a transaction
+    bool has_changes() const {
+        return !savepoints.empty() && undo_log.size() > savepoints.back().undo;
+    }
+
+    // Makes the changes the last rollback undid again, inside a new savepoint (see begin) that is committed
+    // or rolled back like any other. False, changing nothing, when there is nothing to redo or the
+    // inventory changed since that rollback.
+    bool redo() {
+        if (redo_log.empty() || changes != redo_changes) {
+            return false;
+        }
+        begin();
+        for (const Undo& entry : redo_log) {
+            if (entry.kind == Undo::Kind::Quantity) {
+                set_quantity(entry.item, entry.quantity);
+                total_money = entry.money;
+            }
+            else if (entry.kind == Undo::Kind::Removed) {
+                remove(entry.slot);
+            }
+            else {
+                if (entry.kind == Undo::Kind::Loaded) {
+                    set_loaded(entry.slot, true);
+                }
+                items.reserve(item_count + 1);
+                push_item(undone.back(), entry.kind == Undo::Kind::Loaded ? entry.slot : -1);
+                undone.pop_back();
+            }
+        }
+        held.insert(held.end(), redo_held.begin(), redo_held.end());
+        redo_log.clear();
+        redo_held.clear();
+        return true;
+    }
+
+    // open begins without a commit or rollback yet, 0 outside a transaction
+    int get_transaction_depth() const {
+        return (int)savepoints.size();
+    }
+
+    // applies the transactions in order, returns how many of them succeeded (adds and sells of a
+    // quantity that is not positive fail, and so do sales whose money overflows)
+    std::size_t apply(std::span<const Txn> txns) {
+        std::size_t applied = 0;
+        for (const Txn& txn : txns) {
+            if (txn.type == Txn::Type::Add) {
+                if (txn.quantity > 0) {
+                    add(txn.name, txn.quantity, txn.price);
+                    applied++;
+                }
+            }
+            else {
+                try {
+                    applied += sell(txn.name, txn.quantity).status == SellStatus::Sold;
+                }
+                catch (const std::overflow_error&) {
+                    // its money does not fit in a Money, so the sale fails and changes nothing
+                }
+            }
+        }
+        return applied;
+    }
+
+    // applies every transaction or none: false, with nothing changed, if any of them fails. An exception
+    // (out of memory) rolls back as well before it is passed on.
+    bool apply_all(std::span<const Txn> txns) {
+        begin();
+        try {
+            if (apply(txns) != txns.size()) {
+                rollback();
+                return false;
+            }
+        }
+        catch (...) {
+            rollback();
+            throw;
+        }
+        commit();
+        return true;
+    }
+
+    Money get_total_money() const {
+        return total_money;
+    }
+
+    // what the stock on hand is worth at current prices, or nothing when that does not fit in a Money
+    std::optional<Money> stock_value() const {
+        MoneySum value;
+        for_each_item([&](const ItemView& item) { value.add_product(item.price.get_cents(), item.quantity); });
+        return value.total();
+    }
+
+    // Starts an empty inventory from a snapshot (see InventoryStore), taking over the mapping and its
+    // total_money. Nothing is built per item: rows are served from the mapping and only copied into
+    // Items as changes reach them, so loading costs the same for ten items or ten million.
+    void load_snapshot(std::unique_ptr<SnapshotFile> file) {
+        changes++;
+        total_money = file->get_total_money();
+        snapshot = std::move(file);
+    }
+
+    // log every later change to log, nullptr stops logging
+    void attach_log(WriteAheadLog* log) {
+        wal = log;
+    }
+
+    // Writes up to limit items starting at cursor (0 for the first page) and returns the cursor of the
+    // next page, or nothing once every item was written. A cursor is a position in listing order (the
+    // snapshot rows, then the items), so it stays valid while items are added but not across removals
+    // or changes to rows still in the snapshot.
+    std::optional<std::size_t> export_items(ItemExporter& exporter, std::size_t cursor = 0,
+        std::size_t limit = SIZE_MAX) const {
+        std::size_t rows = (std::size_t)snapshot_rows();
+        std::size_t end = rows + (std::size_t)item_count;
+        auto is_live = [&](std::size_t i) {
+            return i < rows ? !is_loaded((int)i) : items[i - rows] != nullptr;
+        };
+        std::size_t i = cursor;
+        for (std::size_t written = 0; i < end && written < limit; i++) {
+            if (!is_live(i)) {
+                continue;
+            }
+            if (i < rows) {
+                ItemView item = snapshot->item(i);
+                exporter.write(item.name, item.quantity, item.price);
+            }
+            else {
+                exporter.write(*items[i - rows]);
+            }
+            written++;
+        }
+        while (i < end && !is_live(i)) {
+            i++; // so an empty last page is never handed out
+        }
+        if (i >= end) {
+            return std::nullopt;
+        }
+        return i;
+    }
+
+    // calls visit(item) with an ItemView for every item in listing order
+    template <typename Visit>
+    void for_each_item(Visit visit) const {
+        for (int row = 0; row < snapshot_rows(); row++) {
+            if (!is_loaded(row)) {
+                visit(snapshot->item(row));
+            }
+        }
+        for (int i = 0; i < item_count; i++) {
+            if (items[i] != nullptr) {
+                visit(view_of(*items[i]));
+            }
+        }
+    }
+
+    int get_item_count() const {
+        return item_count - tombstones + snapshot_rows() - loaded_rows;
+    }
+
+    // Items with min_price <= price <= max_price, cheapest first, valid until the inventory changes. The
+    // ordered indexes only hold Items, so this copies every row still in the snapshot first.
+    OrderedIndex::Range items_priced_between(Money min_price, Money max_price) {
+        load_rows();
+        return by_price.range(min_price.get_cents(), max_price.get_cents());
+    }
+
+    // items with quantity < limit, lowest stock first, valid until the inventory changes; copies the
+    // snapshot rows like items_priced_between
+    OrderedIndex::Range items_with_quantity_below(int limit) {
+        load_rows();
+        return by_quantity.range(INT64_MIN, (std::int64_t)limit - 1);
+    }
+
+    AllocationStats allocation_stats() const {
+        return allocator->stats();
+    }
+
+    MemoryUsage memory_usage() const {
+        std::size_t item_bytes = (std::size_t)get_item_count() * sizeof(Item);
+        std::size_t index_bytes = index.memory_bytes() + by_price.memory_bytes() + by_quantity.memory_bytes();
+        return MemoryUsage{ items.memory_bytes(), item_bytes, index_bytes, names.memory_bytes() };
+    }
+
+    // names of stocked items starting with prefix, in alphabetical order, for autocomplete
+    std::vector<std::string> complete(std::string_view prefix, std::size_t limit = 10) const {
+        std::vector<std::string> result = names_of(search.with_prefix(prefix, limit));
+        if (snapshot) {
+            for (std::uint32_t row : rows_search().with_prefix(prefix, limit)) {
+                result.emplace_back(snapshot->name_of(row));
+            }
+            std::sort(result.begin(), result.end());
+            result.erase(std::unique(result.begin(), result.end()), result.end());
+            if (result.size() > limit) {
+                result.resize(limit);
+            }
+        }
+        return result;
+    }
+
+    // names of stocked items at most max_edits typos away from name, closest first, for "did you mean"
+    std::vector<std::string> suggest(std::string_view name, int max_edits = 2, std::size_t limit = 5) const {
+        std::vector<std::pair<int, std::string>> matches;
+        for (const auto& [distance, id] : search.similar(name, max_edits, limit)) {
+            matches.emplace_back(distance, names.name_of(id));
+        }
+        if (snapshot) {
+            for (const auto& [distance, row] : rows_search().similar(name, max_edits, limit)) {
+                matches.emplace_back(distance, snapshot->name_of(row));
+            }
+            std::sort(matches.begin(), matches.end());
+            matches.erase(std::unique(matches.begin(), matches.end()), matches.end());
+        }
+        std::vector<std::string> result;
+        for (std::size_t i = 0; i < matches.size() && i < limit; i++) {
+            result.push_back(std::move(matches[i].second));
+        }
+        return result;
+    }
+
+    // Interactive front-end
+
+    static void print_names(const std::vector<std::string>& names) {
+        for (std::size_t i = 0; i < names.size(); i++) {
+            std::cout << (i == 0 ? "" : ", ") << names[i];
+        }
+    }
+
+    void add_item() {
+        std::string name;
+        int quantity;
+        double price;
+
+        std::cin.ignore();
+        std::cout << "\nEnter item name: ";
+        std::cin >> name;
+        std::cout << "Enter quantity: ";
+        std::cin >> quantity;
+        std::cout << "Enter price: ";
+        std::cin >> price;
+
+        try {
+            add(name, quantity, Money::from_double(price));
+        }
+        catch (const std::exception&) {
+            std::cout << "\nInvalid price.";
+        }
+    }
+
+    void sell_item() {
+        std::string item_to_check;
+        std::cin.ignore();
+        std::cout << "\nEnter item name: ";
+        std::cin >> item_to_check;
+
+        if (find(item_to_check) >= 0 || find_row(item_to_check) >= 0) {
+            remove_item(item_to_check);
+            return;
+        }
+        std::cout << "\nThis item is not in your Inventory";
+        std::vector<std::string> suggestions = suggest(item_to_check);
+        if (!suggestions.empty()) {
+            std::cout << "\nDid you mean: ";
+            print_names(suggestions);
+        }
+    }
+
+    void search_items() {
+        std::string text;
+        std::cin.ignore();
+        std::cout << "\nEnter the start of an item name: ";
+        std::cin >> text;
+
+        std::vector<std::string> matches = complete(text);
+        if (!matches.empty()) {
+            std::cout << "\nItems starting with " << text << ": ";
+            print_names(matches);
+            return;
+        }
+        std::vector<std::string> suggestions = suggest(text);
+        if (!suggestions.empty()) {
+            std::cout << "\nNo item starts with " << text << ", did you mean: ";
+            print_names(suggestions);
+            return;
+        }
+        std::cout << "\nNo matching items.";
+    }
+
+    void remove_item(const std::string& name) {
+        int input_quantity;
+        std::cout << "\nEnter number of items to sell: ";
+        std::cin >> input_quantity;
+
+        SellResult result;
+        try {
+            result = sell(name, input_quantity);
+        }
+        catch (const std::overflow_error&) {
+            std::cout << "\nThe money from this sale does not fit in the total, nothing was sold.";
+            return;
+        }
+        if (result.status == SellStatus::Sold) {
+            std::cout << "\nItems sold";
+            std::cout << "\nMoney received: " << result.money_earned;
+            if (result.removed) {
+                std::cout << "\nItem removed from inventory as quantity is zero.";
+            }
+        }
+        else if (result.status == SellStatus::InvalidQuantity) {
+            std::cout << "\nThe number of items to sell must be positive.";
+        }
+        else {
+            std::cout << "\nCannot sell more items than you have.";
+        }
+    }
+
+    // shows a page of items at a time so a large inventory does not scroll past
+    void list_items() {
+        if (get_item_count() == 0) {
+            std::cout << "\nInventory empty.";
+            return;
+        }
+
+        const std::size_t page = 100;
+        std::optional<std::size_t> cursor = 0;
+        while (true) {
+            {
+                ItemExporter exporter(std::cout, ExportFormat::Text);
+                cursor = export_items(exporter, *cursor, page);
+            }
+            if (!cursor) {
+                return;
+            }
+            char answer;
+            std::cout << "\nShow more items? (y/n): ";
+            std::cin >> answer;
+            if (answer != 'y' && answer != 'Y') {
+                return;
+            }
+        }
+    }
+};
+
+// Transaction for a scope: begins on construction and rolls back on destruction unless committed first,
+// so an early return or an exception leaves the inventory untouched. Nests like begin does.
+class InventoryTransaction {
+private:
+    Inventory& inventory;
+    bool open;
+
+public:
+    explicit InventoryTransaction(Inventory& inventory) :
+        inventory{ inventory },
+        open{ true } {
+        inventory.begin();
+    }
+
+    InventoryTransaction(const InventoryTransaction&) = delete;
+    InventoryTransaction& operator=(const InventoryTransaction&) = delete;
+
+    ~InventoryTransaction() {
+        rollback();
+    }
+
+    void commit() {
+        if (open) {
+            inventory.commit();
+            open = false;
+        }
+    }
+
+    void rollback() {
+        if (open) {
+            inventory.rollback();
+            open = false;
+        }
+    }
+};
 
-public:
-    Item(
-        std::string name,
-        int quantity,
-        float price
-    ) :
-        name{ std::move(name) },
-        quantity{ quantity },
-        price{ price } {
+// Reads a transaction log for --replay. Either CSV with one transaction per line:
+//     add,<name>,<quantity>,<price>
+//     sell,<name>,<quantity>
+// or binary, starting with the 8 byte magic "INVTXN1\n" followed by records of
+//     uint8 type (0 = add, 1 = sell), uint8 name length, int32 quantity, float price, name bytes
+// in native byte order.
+class TxnLogReader {
+private:
+    std::ifstream in;
+    bool binary;
+    std::size_t skipped; // malformed CSV lines and binary records of an unknown type
 
+    bool read_binary(Txn& txn) {
+        while (true) {
+            std::uint8_t type;
+            std::uint8_t name_length;
+            std::int32_t quantity;
+            float price;
+            in.read(reinterpret_cast<char*>(&type), sizeof(type));
+            in.read(reinterpret_cast<char*>(&name_length), sizeof(name_length));
+            in.read(reinterpret_cast<char*>(&quantity), sizeof(quantity));
+            in.read(reinterpret_cast<char*>(&price), sizeof(price));
+            txn.name.resize(name_length);
+            in.read(txn.name.data(), name_length);
+            if (!in) {
+                return false;
+            }
+            if (type > 1) {
+                skipped++;
+                continue;
+            }
+            txn.type = type == 0 ? Txn::Type::Add : Txn::Type::Sell;
+            txn.quantity = quantity;
+            try {
+                txn.price = type == 0 ? Money::from_double(price) : Money();
+            }
+            catch (const std::exception&) {
+                skipped++; // a NaN, infinite or huge price
+                continue;
+            }
+            return true;
+        }
     }
 
-    std::string get_name() const {
-        return name;
+    bool read_csv(Txn& txn) {
+        std::string line;
+        while (std::getline(in, line)) {
+            std::stringstream fields(line);
+            std::string type;
+            std::string quantity;
+            std::string price;
+            std::getline(fields, type, ',');
+            std::getline(fields, txn.name, ',');
+            std::getline(fields, quantity, ',');
+            std::getline(fields, price, ',');
+            try {
+                if (type == "add") {
+                    txn.type = Txn::Type::Add;
+                    txn.quantity = std::stoi(quantity);
+                    txn.price = Money::from_double(std::stod(price));
+                    return true;
+                }
+                if (type == "sell") {
+                    txn.type = Txn::Type::Sell;
+                    txn.quantity = std::stoi(quantity);
+                    txn.price = Money();
+                    return true;
+                }
+            }
+            catch (const std::exception&) {
+                // fall through and skip the line
+            }
+            if (!line.empty()) {
+                skipped++;
+            }
+        }
+        return false;
     }
 
-    int get_quantity() const {
-        return quantity;
+public:
+    explicit TxnLogReader(const std::string& path) :
+        in{ path, std::ios::binary },
+        binary{ false },
+        skipped{ 0 } {
+
+        char magic[8] = {};
+        in.read(magic, sizeof(magic));
+        binary = in.gcount() == sizeof(magic) && std::memcmp(magic, "INVTXN1\n", sizeof(magic)) == 0;
+        if (!binary) {
+            in.clear();
+            in.seekg(0);
+        }
     }
 
-    void set_quantity(int new_quantity) {
-        quantity = new_quantity;
+    bool is_open() const {
+        return in.is_open();
     }
 
-    float get_price() const {
-        return price;
+    std::size_t get_skipped() const {
+        return skipped;
     }
 
-    bool is_match(const std::string& other) {
-        return name == other;
+    // refills batch with up to max transactions, returns false once the log is exhausted
+    bool next_batch(std::vector<Txn>& batch, std::size_t max) {
+        batch.resize(max);
+        std::size_t count = 0;
+        while (count < max && (binary ? read_binary(batch[count]) : read_csv(batch[count]))) {
+            count++;
+        }
+        batch.resize(count);
+        return count > 0;
     }
 };
 
-class Inventory {
+// Keeps an Inventory on disk in a directory holding
+//     inventory.snap  every item and total_money as of the start of one WAL generation
+//     inventory.wal   the WriteAheadLog of changes made since then
+// open loads the latest snapshot and replays only the log, then attaches the log to the inventory so
+// every later add, sell and remove is recorded. checkpoint writes a fresh snapshot and starts the
+// next generation of the log, which is what keeps the replay on startup short.
+//
+// Snapshots are read through a SnapshotFile, and the inventory serves their rows straight from the
+// mapping (see Inventory::load_snapshot), so opening a store checks the records but builds nothing per
+// item. The menu and --replay also checkpoint when they finish, so a store of any size restarts from a
+// snapshot and replays only what changed before a crash. Snapshots and logs are written to a .tmp file
+// and renamed into place, so a crash leaves either the old file or the new one, never half of one;
+// renaming over the snapshot the inventory still maps is fine, the mapping keeps the old file.
+class InventoryStore {
+public:
+    struct Recovery {
+        std::size_t items_loaded;     // from the snapshot
+        std::size_t records_replayed; // from the log
+        std::size_t torn_bytes;       // cut off the end of the log
+        double seconds;
+    };
+
 private:
-    Item* items[20];  // Kept it as array as I wasn't sure I was allowed to modify this
-    float total_money;
-    int item_count;
+    Inventory& inventory;
+    std::string directory;
+    WriteAheadLog wal;
+    std::size_t snapshot_interval; // checkpoint once the log holds this many records, 0 = only when asked
+    Recovery recovery;
+    std::string error;
 
-    static void display_data(Item& item) {
-        std::cout << "\nItem name: " << item.get_name();
-        std::cout << "\nQuantity: " << item.get_quantity();
-        std::cout << "\nPrice: " << item.get_price();
+    std::string snapshot_path() const {
+        return directory + "/inventory.snap";
+    }
+
+    std::string wal_path() const {
+        return directory + "/inventory.wal";
+    }
+
+    bool fail(std::string message) {
+        error = std::move(message);
+        return false;
+    }
+
+    // generation of the snapshot, 0 when there is none yet
+    std::optional<std::uint64_t> load_snapshot() {
+        auto snapshot = std::make_unique<SnapshotFile>(snapshot_path());
+        if (!snapshot->is_open()) {
+            return 0;
+        }
+        if (!snapshot->is_valid()) {
+            return std::nullopt;
+        }
+        std::uint64_t generation = snapshot->get_generation();
+        recovery.items_loaded = snapshot->size();
+        inventory.load_snapshot(std::move(snapshot));
+        return generation;
+    }
+
+    bool write_snapshot(std::uint64_t generation) {
+        std::string temporary = snapshot_path() + ".tmp";
+        std::FILE* file = std::fopen(temporary.c_str(), "wb");
+        if (file == nullptr) {
+            return false;
+        }
+        std::setvbuf(file, nullptr, _IOFBF, 1 << 20);
+
+        SnapshotHeader header{};
+        std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+        header.generation = generation;
+        header.total_money_cents = inventory.get_total_money().get_cents();
+        inventory.for_each_item([&](const ItemView& item) {
+            header.item_count++;
+            header.names_bytes += item.name.size();
+        });
+        std::fwrite(&header, sizeof(header), 1, file);
+
+        // two passes so the records can be fixed size and the names packed after them
+        std::uint64_t name_offset = 0;
+        inventory.for_each_item([&](const ItemView& item) {
+            SnapshotItem record{
+                item.price.get_cents(),
+                name_offset,
+                (std::uint32_t)item.name.size(),
+                item.quantity
+            };
+            std::fwrite(&record, sizeof(record), 1, file);
+            name_offset += record.name_length;
+        });
+        inventory.for_each_item([&](const ItemView& item) {
+            std::fwrite(item.name.data(), 1, item.name.size(), file);
+        });
+
+        bool written = !std::ferror(file) && flush_to_disk(file);
+        written = std::fclose(file) == 0 && written;
+        std::error_code rename_error;
+        if (written) {
+            std::filesystem::rename(temporary, snapshot_path(), rename_error);
+        }
+        sync_directory(directory);
+        return written && !rename_error;
     }
 
 public:
-    Inventory() :
-        items{},
-        total_money{ 0 },
-        item_count{ 0 } {
+    // inventory must be empty and outlive the store
+    InventoryStore(Inventory& inventory, std::string directory, std::size_t group_size = 256,
+        std::size_t snapshot_interval = 1 << 20) :
+        inventory{ inventory },
+        directory{ std::move(directory) },
+        wal{ group_size },
+        snapshot_interval{ snapshot_interval },
+        recovery{},
+        error{} {
 
     }
 
-    void add_item() {
-        std::string name;
-        int quantity;
-        float price;
+    InventoryStore(const InventoryStore&) = delete;
+    InventoryStore& operator=(const InventoryStore&) = delete;
 
-        std::cin.ignore();
-        std::cout << "\nEnter item name: ";
-        std::cin >> name;
-        std::cout << "Enter quantity: ";
-        std::cin >> quantity;
-        std::cout << "Enter price: ";
-        std::cin >> price;
+    ~InventoryStore() {
+        inventory.attach_log(nullptr);
+    }
 
-        items[item_count] = new Item(name, quantity, price);
-        item_count++;
+    // loads the snapshot, replays the log after it and starts logging, false (see get_error) on failure
+    bool open() {
+        auto start = std::chrono::steady_clock::now();
+        std::error_code dir_error;
+        std::filesystem::create_directories(directory, dir_error);
+        if (dir_error) {
+            return fail("cannot create " + directory);
+        }
+
+        std::optional<std::uint64_t> generation = load_snapshot();
+        if (!generation) {
+            return fail(snapshot_path() + " is damaged");
+        }
+
+        bool logging = false;
+        {
+            MappedFile log(wal_path());
+            std::optional<std::uint64_t> log_generation = log.is_open() ? WriteAheadLog::read_generation(log.data()) : std::nullopt;
+            if (log_generation && *log_generation > *generation) {
+                return fail(wal_path() + " is newer than the snapshot");
+            }
+            // an older log was already folded into the snapshot, the crash came before it was replaced
+            if (log_generation && *log_generation == *generation) {
+                std::size_t valid = WriteAheadLog::scan(log.data(), [&](const WriteAheadLog::Record& record) {
+                    if (record.op == WriteAheadLog::Op::Add) {
+                        inventory.add(record.name, record.quantity, record.price);
+                    }
+                    else if (record.op == WriteAheadLog::Op::Sell) {
+                        inventory.sell(std::string(record.name), record.quantity);
+                    }
+                    else {
+                        inventory.remove(std::string(record.name));
+                    }
+                    recovery.records_replayed++;
+                });
+                recovery.torn_bytes = log.data().size() - valid;
+                logging = wal.open_append(wal_path(), *generation, valid, recovery.records_replayed);
+                if (!logging) {
+                    return fail("cannot append to " + wal_path());
+                }
+            }
+        }
+        if (!logging && !wal.create(wal_path(), *generation)) {
+            return fail("cannot create " + wal_path());
+        }
+
+        inventory.attach_log(&wal);
+        recovery.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return true;
     }
 
-    void sell_item() {
-        std::string item_to_check;
-        std::cin.ignore();
-        std::cout << "\nEnter item name: ";
-        std::cin >> item_to_check;
+    // makes every change so far durable, and checkpoints once the log holds snapshot_interval records
+    bool commit() {
+        if (!wal.commit()) {
+            return fail("cannot write " + wal_path());
+        }
+        // a snapshot now would hold the open transaction's changes
+        if (snapshot_interval > 0 && wal.get_records() >= snapshot_interval && inventory.get_transaction_depth() == 0) {
+            return checkpoint();
+        }
+        return true;
+    }
 
-        for (int i = 0; i < item_count; i++) {
-            if (items[i]->is_match(item_to_check)) {
-                remove_item(i);
-                return;
+    // Commits the inventory's innermost transaction, see Inventory::commit. Committing the outermost one
+    // writes its changes to the log as one batch and makes them durable like commit, so after a crash
+    // the transaction is replayed whole or not at all.
+    bool commit_transaction() {
+        inventory.commit();
+        if (inventory.get_transaction_depth() > 0) {
+            return true;
+        }
+        return commit();
+    }
+
+    // writes a snapshot of the whole inventory and starts the next log generation
+    bool checkpoint() {
+        if (inventory.get_transaction_depth() > 0) {
+            return fail("cannot checkpoint inside a transaction");
+        }
+        if (!wal.commit()) {
+            return fail("cannot write " + wal_path());
+        }
+        std::uint64_t next = wal.get_generation() + 1;
+        if (!write_snapshot(next)) {
+            return fail("cannot write " + snapshot_path());
+        }
+        // from here a crash is safe, the old log is ignored once the snapshot is newer
+        if (!wal.create(wal_path(), next)) {
+            return fail("cannot create " + wal_path());
+        }
+        return true;
+    }
+
+    const Recovery& get_recovery() const {
+        return recovery;
+    }
+
+    const std::string& get_error() const {
+        return error;
+    }
+};
+
+void print_recovery(const InventoryStore::Recovery& recovery) {
+    std::cout << "Recovered " << recovery.items_loaded << " items from the snapshot and "
+        << recovery.records_replayed << " log records in " << recovery.seconds << " s";
+    if (recovery.torn_bytes > 0) {
+        std::cout << " (" << recovery.torn_bytes << " torn bytes cut off the log)";
+    }
+    std::cout << "\n";
+}
+
+// What replay_log keeps besides its report, all optional
+struct ReplayOutputs {
+    std::string data_directory; // recover the inventory from here first and log every change, see InventoryStore
+    std::string export_path;    // export the final stock here
+    ExportFormat export_format = ExportFormat::Csv;
+    std::string stats_path;     // dump inventory_stats() here as JSON lines, see StatsDumper
+    std::chrono::milliseconds stats_interval{ 1000 };
+};
+
+// "text", "csv", "jsonl" or "binary"
+std::optional<ExportFormat> parse_export_format(const std::string& name) {
+    if (name == "text") {
+        return ExportFormat::Text;
+    }
+    if (name == "csv") {
+        return ExportFormat::Csv;
+    }
+    if (name == "jsonl") {
+        return ExportFormat::JsonLines;
+    }
+    if (name == "binary") {
+        return ExportFormat::Binary;
+    }
+    return std::nullopt;
+}
+
+// writes every item to path, reports how long it took
+bool export_to_file(const Inventory& inventory, const std::string& path, ExportFormat format) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        return false;
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::size_t exported;
+    {
+        ItemExporter exporter(out, format);
+        inventory.export_items(exporter);
+        exported = exporter.get_exported();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Exported " << exported << " items to " << path << " in " << seconds << " s\n";
+    return (bool)out;
+}
+
+// per-operation latency percentiles and counters, for --replay in an INVENTORY_STATS build
+void print_stats(const InventoryStats& stats) {
+    for (int op = 0; op < stat_op_count; op++) {
+        const OperationStats& operation = stats.ops[op];
+        std::cout << "Latency of " << stat_op_name((StatOp)op) << ": " << operation.latency.get_count() << " calls, p50 "
+            << operation.latency.percentile(0.5) << " ns, p99 " << operation.latency.percentile(0.99) << " ns, p999 "
+            << operation.latency.percentile(0.999) << " ns, max " << operation.latency.get_max() << " ns ("
+            << operation.hits << " hits, " << operation.misses << " misses)\n";
+    }
+    std::cout << "Items moved by removals: " << stats.moved << "\n";
+}
+
+// streams a transaction log through inventory and reports the throughput
+int replay_log(const std::string& path, Inventory inventory, const ReplayOutputs& outputs) {
+    TxnLogReader reader(path);
+    if (!reader.is_open()) {
+        std::cerr << "Cannot open " << path << "\n";
+        return 1;
+    }
+    std::optional<InventoryStore> store;
+    if (!outputs.data_directory.empty()) {
+        store.emplace(inventory, outputs.data_directory);
+        if (!store->open()) {
+            std::cerr << store->get_error() << "\n";
+            return 1;
+        }
+        print_recovery(store->get_recovery());
+    }
+
+    std::ofstream stats_file;
+    std::optional<StatsDumper> dumper;
+    if (!outputs.stats_path.empty()) {
+        if (!stats_enabled) {
+            std::cerr << "Built without INVENTORY_STATS, " << outputs.stats_path << " will only hold zeros\n";
+        }
+        stats_file.open(outputs.stats_path);
+        if (!stats_file) {
+            std::cerr << "Cannot write " << outputs.stats_path << "\n";
+            return 1;
+        }
+        dumper.emplace(stats_file, outputs.stats_interval);
+    }
+
+    std::vector<Txn> batch;
+    std::size_t total = 0;
+    std::size_t applied = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (reader.next_batch(batch, 4096)) {
+        applied += inventory.apply(batch);
+        total += batch.size();
+        if (store && !store->commit()) {
+            std::cerr << store->get_error() << "\n";
+            return 1;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    // the replay finished cleanly, so the next start loads the snapshot instead of replaying the log
+    if (store && !store->checkpoint()) {
+        std::cerr << store->get_error() << "\n";
+        return 1;
+    }
+
+    std::cout << "Replayed " << total << " transactions (" << applied << " applied, "
+        << reader.get_skipped() << " malformed records skipped) in " << seconds << " s\n";
+    std::cout << "Throughput: " << (seconds > 0 ? total / seconds : 0) << " transactions/s\n";
+    std::cout << "Items left: " << inventory.get_item_count() << "\n";
+    std::cout << "Total money: " << inventory.get_total_money() << "\n";
+    std::cout << "Items with quantity below 5: " << inventory.items_with_quantity_below(5).size() << "\n";
+    MemoryUsage memory = inventory.memory_usage();
+    std::cout << "Memory: " << memory.total() << " bytes (slots " << memory.slots
+        << ", items " << memory.items << ", index " << memory.index << ", names " << memory.names << ")\n";
+    AllocationStats allocations = inventory.allocation_stats();
+    std::cout << "Item allocations: " << allocations.allocations << " (" << allocations.deallocations
+        << " freed, " << allocations.heap_calls << " heap calls)\n";
+    if (!outputs.export_path.empty() && !export_to_file(inventory, outputs.export_path, outputs.export_format)) {
+        std::cerr << "Cannot write " << outputs.export_path << "\n";
+        return 1;
+    }
+    if (stats_enabled) {
+        print_stats(inventory_stats());
+    }
+    return 0;
+}
+
+// --bench: micro-benchmarks of the Inventory API over sizes and access patterns. Results are written
+// as JSON (one result per line, so a baseline can be read back without a JSON library) and, given a
+// baseline from an earlier run, any case that got slower by more than max_regression percent fails
+// the run. Both versions write the same case names, so their results can be compared directly.
+struct BenchResult {
+    std::string name; // <operation>[/<access>]/<items>
+    double ns_per_op;
+};
+
+// discards everything written to it, for timing list without a terminal
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override {
+        return c;
+    }
+
+    std::streamsize xsputn(const char*, std::streamsize n) override {
+        return n;
+    }
+};
+
+// count item indices below n, uniform or Zipf distributed (s = 1.1, item 0 the hottest)
+std::vector<std::uint32_t> bench_picks(std::size_t n, std::size_t count, bool zipf, std::mt19937& rng) {
+    std::vector<std::uint32_t> picks(count);
+    if (!zipf) {
+        std::uniform_int_distribution<std::uint32_t> uniform(0, (std::uint32_t)n - 1);
+        for (std::uint32_t& pick : picks) {
+            pick = uniform(rng);
+        }
+        return picks;
+    }
+    std::vector<double> cdf(n);
+    double sum = 0;
+    for (std::size_t i = 0; i < n; i++) {
+        sum += 1.0 / std::pow((double)(i + 1), 1.1);
+        cdf[i] = sum;
+    }
+    std::uniform_real_distribution<double> uniform(0, sum);
+    for (std::uint32_t& pick : picks) {
+        std::size_t i = std::lower_bound(cdf.begin(), cdf.end(), uniform(rng)) - cdf.begin();
+        pick = (std::uint32_t)std::min(i, n - 1);
+    }
+    return picks;
+}
+
+template <typename Work>
+double time_ns(Work work) {
+    auto start = std::chrono::steady_clock::now();
+    work();
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+void bench_size(std::size_t n, std::vector<BenchResult>& results) {
+    const std::size_t operations = 200000;
+    const std::size_t repeats = std::max<std::size_t>(1, operations / n); // small sizes are timed several times
+    std::string size = std::to_string(n);
+    std::mt19937 rng((unsigned)n);
+    std::vector<std::string> names(n);
+    for (std::size_t i = 0; i < n; i++) {
+        names[i] = "sku" + std::to_string(i);
+    }
+    auto fill = [&](Inventory& inventory, int quantity) {
+        for (std::size_t i = 0; i < n; i++) {
+            inventory.add(names[i], quantity, Money::from_cents(100 + (std::int64_t)(i % 1000)));
+        }
+    };
+
+    double add_ns = 0;
+    for (std::size_t r = 0; r < repeats; r++) {
+        Inventory inventory;
+        add_ns += time_ns([&] { fill(inventory, 1); });
+    }
+    results.push_back(BenchResult{ "add/" + size, add_ns / (double)(n * repeats) });
+
+    {
+        Inventory inventory;
+        fill(inventory, 1 << 20); // more than any item is sold
+        for (bool zipf : { false, true }) {
+            std::vector<std::uint32_t> picks = bench_picks(n, operations, zipf, rng);
+            double ns = time_ns([&] {
+                for (std::uint32_t pick : picks) {
+                    inventory.sell(names[pick], 1);
+                }
+            });
+            results.push_back(BenchResult{ std::string("sell_hit/") + (zipf ? "zipf/" : "uniform/") + size, ns / (double)operations });
+        }
+
+        std::vector<std::string> missing(std::min<std::size_t>(n, 10000));
+        for (std::size_t i = 0; i < missing.size(); i++) {
+            missing[i] = "missing" + std::to_string(i);
+        }
+        double ns = time_ns([&] {
+            for (std::size_t op = 0; op < operations; op++) {
+                inventory.sell(missing[op % missing.size()], 1);
             }
+        });
+        results.push_back(BenchResult{ "sell_miss/" + size, ns / (double)operations });
+
+        NullBuffer null_buffer;
+        std::ostream null_stream(&null_buffer);
+        double list_ns = 0;
+        double value_ns = 0;
+        volatile std::int64_t sink = 0; // keeps the valuation from being optimized away
+        for (std::size_t r = 0; r < repeats; r++) {
+            list_ns += time_ns([&] {
+                ItemExporter exporter(null_stream, ExportFormat::Text);
+                inventory.export_items(exporter);
+            });
+            value_ns += time_ns([&] { sink = inventory.stock_value().value_or(Money()).get_cents(); });
         }
-        std::cout << "\nThis item is not in your Inventory";
+        results.push_back(BenchResult{ "list/" + size, list_ns / (double)(n * repeats) });
+        results.push_back(BenchResult{ "valuation/" + size, value_ns / (double)(n * repeats) });
     }
 
-    void remove_item(int item_index) {
-        int input_quantity;
-        Item* item = items[item_index];
-        std::cout << "\nEnter number of items to sell: ";
-        std::cin >> input_quantity;
+    // selling the last unit removes the item, with the default RemovalMode::Shift, which is O(n) per
+    // removal, so fewer removals are timed on large inventories
+    std::size_t removals = std::min<std::size_t>(n, std::clamp<std::size_t>(100000000 / n, 10, 1000));
+    std::vector<std::uint32_t> order(n);
+    for (std::size_t i = 0; i < n; i++) {
+        order[i] = (std::uint32_t)i;
+    }
+    std::shuffle(order.begin(), order.end(), rng);
+    std::size_t remove_repeats = std::max<std::size_t>(1, 1000 / n);
+    double remove_ns = 0;
+    for (std::size_t r = 0; r < remove_repeats; r++) {
+        Inventory inventory;
+        fill(inventory, 1);
+        remove_ns += time_ns([&] {
+            for (std::size_t i = 0; i < removals; i++) {
+                inventory.sell(names[order[i]], 1);
+            }
+        });
+    }
+    results.push_back(BenchResult{ "remove_to_zero/" + size, remove_ns / (double)(removals * remove_repeats) });
+}
 
-        int quantity = item->get_quantity();
-        if (input_quantity <= quantity) {
-            float price = item->get_price();
-            float money_earned = price * input_quantity;
-            item->set_quantity(quantity - input_quantity);
-            std::cout << "\nItems sold";
-            std::cout << "\nMoney received: " << money_earned;
-            total_money += money_earned;
-
-            //Modifed and Updated code here:
-            // if the quantity reaches zero, delete the item and shift others
-            if (item->get_quantity() == 0) {
-                delete item; // free the memory of item
-                // Shift items in array to fill the empty spaces (shifted spaces)
-                for (int i = item_index; i < item_count - 1; i++) {
-                    items[i] = items[i + 1];
-                }
-                items[item_count - 1] = nullptr; // set last item to nullptr
-                item_count--; // decrease item count
-                std::cout << "\nItem removed from inventory as quantity is zero.";
+void write_bench_json(std::ostream& out, const std::vector<BenchResult>& results) {
+    out << "{\n  \"implementation\": \"" << "array" << "\",\n  \"results\": [\n";
+    for (std::size_t i = 0; i < results.size(); i++) {
+        out << "    {\"name\": \"" << results[i].name << "\", \"ns_per_op\": " << results[i].ns_per_op << "}"
+            << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+}
+
+// reads back what write_bench_json wrote, other JSON layouts are not understood
+std::vector<BenchResult> read_bench_json(std::istream& in) {
+    std::vector<BenchResult> results;
+    std::string line;
+    const std::string name_key = "\"name\": \"";
+    const std::string time_key = "\"ns_per_op\": ";
+    while (std::getline(in, line)) {
+        std::size_t name_at = line.find(name_key);
+        std::size_t time_at = line.find(time_key);
+        if (name_at == std::string::npos || time_at == std::string::npos) {
+            continue;
+        }
+        name_at += name_key.size();
+        std::string name = line.substr(name_at, line.find('"', name_at) - name_at);
+        try {
+            results.push_back(BenchResult{ name, std::stod(line.substr(time_at + time_key.size())) });
+        }
+        catch (const std::exception&) {
+            // skip the line
+        }
+    }
+    return results;
+}
+
+// what the transaction checks compare: the items in listing order and total_money
+std::string describe(const Inventory& inventory) {
+    std::ostringstream out;
+    {
+        ItemExporter exporter(out, ExportFormat::Csv);
+        inventory.export_items(exporter);
+    }
+    out << "money " << inventory.get_total_money() << "\n";
+    return out.str();
+}
+
+// --txn: checks that transactions leave the inventory as they should: nested savepoints rolled back,
+// redone and committed in every RemovalMode, apply_all failing partway, sales whose money overflows,
+// freed names reused, a store recovered from its log after a commit, after a rollback and after a crash
+// cut a transaction's batch short, a store restarted from its snapshot, and the menu keeping one change
+// open.
+int check_transactions() {
+    int checks = 0;
+    int failures = 0;
+    auto expect = [&](bool ok, const std::string& what) {
+        checks++;
+        if (!ok) {
+            std::cout << "FAILED: " << what << "\n";
+            failures++;
+        }
+    };
+    auto price = [](std::int64_t cents) { return Money::from_cents(cents); };
+
+    const std::pair<RemovalMode, const char*> modes[] = {
+        { RemovalMode::Shift, "shift" }, { RemovalMode::SwapAndPop, "swap" }, { RemovalMode::Tombstone, "tombstone" }
+    };
+    for (const auto& [mode, mode_name] : modes) {
+        std::string name = mode_name;
+        Inventory inventory(mode);
+        for (int i = 0; i < 8; i++) {
+            inventory.add("item" + std::to_string(i), 1 + i, price(100 + i));
+        }
+        std::string before = describe(inventory);
+        inventory.begin();
+        inventory.sell("item0", 1); // sold out, so removed
+        inventory.sell("item5", 2);
+        inventory.add("extra", 3, price(250));
+        std::string outer = describe(inventory);
+        inventory.begin();
+        inventory.remove(std::string("item3"));
+        inventory.sell("extra", 3); // removes an item added by the enclosing savepoint
+        inventory.add("inner", 1, price(999));
+        inventory.sell("item7", 4);
+        std::string inner = describe(inventory);
+        inventory.rollback();
+        expect(describe(inventory) == outer, name + ": rollback of a savepoint");
+        expect(inventory.redo() && describe(inventory) == inner, name + ": redo of a savepoint");
+        inventory.commit();
+        expect(inventory.get_transaction_depth() == 1 && describe(inventory) == inner, name + ": commit of a savepoint");
+        inventory.rollback();
+        expect(describe(inventory) == before, name + ": rollback of the transaction");
+        expect(inventory.redo() && describe(inventory) == inner, name + ": redo of the transaction");
+        inventory.commit();
+        expect(inventory.get_transaction_depth() == 0 && describe(inventory) == inner, name + ": commit of the transaction");
+        inventory.begin();
+        inventory.sell("item2", 1);
+        inventory.rollback();
+        inventory.add("later", 1, price(100));
+        expect(!inventory.redo(), name + ": no redo once the inventory changed");
+        // the indexes still agree with the items
+        expect(inventory.sell("inner", 1).status == SellStatus::Sold && inventory.sell("item3", 1).status == SellStatus::NotFound,
+            name + ": lookups after the transaction");
+        expect(inventory.complete("item").size() == 6 && inventory.complete("ext").empty(), name + ": name search after the transaction");
+    }
+
+    {
+        Inventory inventory;
+        inventory.add("a", 2, price(100));
+        inventory.add("dear", 3, price(INT64_MAX / 2));
+        std::string before = describe(inventory);
+        std::vector<Txn> failing = {
+            Txn{ Txn::Type::Add, "b", 1, price(100) },
+            Txn{ Txn::Type::Sell, "a", 1, Money() },
+            Txn{ Txn::Type::Sell, "missing", 1, Money() },
+            Txn{ Txn::Type::Add, "c", 1, price(100) }
+        };
+        expect(!inventory.apply_all(failing) && describe(inventory) == before, "apply_all failing partway");
+        std::vector<Txn> overflowing = {
+            Txn{ Txn::Type::Sell, "a", 1, Money() },
+            Txn{ Txn::Type::Sell, "dear", 3, Money() } // its money does not fit in a Money
+        };
+        expect(!inventory.apply_all(overflowing) && describe(inventory) == before, "apply_all with a sale whose money overflows");
+        expect(inventory.apply_all(std::span<const Txn>(failing.data(), 2)) && describe(inventory) != before, "apply_all succeeding");
+    }
+    {
+        // each sale fits in a Money, the second one takes total_money past INT64_MAX
+        Inventory inventory;
+        inventory.add("dear", 3, price(5000000000000000000));
+        expect(inventory.sell("dear", 1).status == SellStatus::Sold, "sale of a dear item");
+        std::string before = describe(inventory);
+        bool threw = false;
+        try {
+            inventory.sell("dear", 1);
+        }
+        catch (const std::overflow_error&) {
+            threw = true;
+        }
+        expect(threw && describe(inventory) == before, "sale overflowing total_money throws and changes nothing");
+        std::vector<Txn> sales = {
+            Txn{ Txn::Type::Sell, "dear", 1, Money() },
+            Txn{ Txn::Type::Sell, "dear", 1, Money() }
+        };
+        expect(inventory.apply(sales) == 0 && describe(inventory) == before, "apply fails sales overflowing total_money");
+    }
+
+    {
+        // a sold out name is freed and its id goes to the next new name, which the search has to re-sort
+        Inventory inventory;
+        inventory.add("m", 1, price(100));
+        inventory.add("zeta", 1, price(100));
+        expect(inventory.complete("").size() == 2, "name search before a name is freed");
+        inventory.sell("zeta", 1);
+        inventory.add("a", 1, price(100));
+        expect(inventory.complete("") == std::vector<std::string>{ "a", "m" } && inventory.complete("a").size() == 1
+            && inventory.complete("z").empty(), "name search after a freed id is reused");
+    }
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "inventory-txn-check";
+    std::filesystem::remove_all(directory);
+    std::string committed;
+    {
+        Inventory inventory;
+        InventoryStore store(inventory, directory.string(), 2); // tiny groups, so batches are split across writes
+        expect(store.open(), "open a new store");
+        inventory.add("a", 5, price(100));
+        inventory.add("b", 5, price(200));
+        store.commit();
+        inventory.begin();
+        inventory.sell("a", 2);
+        inventory.add("c", 1, price(300));
+        inventory.begin();
+        inventory.sell("b", 5);
+        store.commit_transaction();
+        expect(inventory.get_transaction_depth() == 1, "commit_transaction of a savepoint");
+        store.commit_transaction();
+        inventory.begin();
+        inventory.sell("a", 3);
+        inventory.add("d", 1, price(400));
+        inventory.rollback();
+        committed = describe(inventory);
+    }
+    {
+        Inventory inventory;
+        InventoryStore store(inventory, directory.string(), 2);
+        expect(store.open() && describe(inventory) == committed, "log replay after a commit and a rollback");
+        inventory.begin();
+        inventory.sell("a", 1);
+        inventory.add("e", 2, price(500));
+        inventory.sell("c", 1);
+        store.commit_transaction();
+    }
+    // cut the log inside the End of that last batch, as a crash in the middle of writing it would
+    std::filesystem::path log = directory / "inventory.wal";
+    std::filesystem::resize_file(log, std::filesystem::file_size(log) - 5);
+    {
+        Inventory inventory;
+        InventoryStore store(inventory, directory.string(), 2);
+        expect(store.open() && describe(inventory) == committed && store.get_recovery().torn_bytes > 0,
+            "log replay without a batch cut short");
+    }
+    {
+        // a store restarted from its snapshot serves the rows from the mapping until they change
+        std::filesystem::remove_all(directory);
+        std::string saved;
+        {
+            Inventory inventory;
+            InventoryStore store(inventory, directory.string());
+            expect(store.open(), "open a store to checkpoint");
+            inventory.add("a", 5, price(100));
+            inventory.add("b", 5, price(200));
+            inventory.add("c", 1, price(300));
+            inventory.sell("b", 1);
+            expect(store.checkpoint(), "checkpoint");
+            saved = describe(inventory);
+        }
+        Inventory inventory;
+        InventoryStore store(inventory, directory.string());
+        expect(store.open() && store.get_recovery().items_loaded == 3 && store.get_recovery().records_replayed == 0
+            && describe(inventory) == saved, "restart from the snapshot");
+        expect(inventory.sell("b", 9).status == SellStatus::NotEnoughStock && describe(inventory) == saved,
+            "a failed sale leaves the row in the snapshot");
+        expect(inventory.complete("") == std::vector<std::string>{ "a", "b", "c" } && inventory.suggest("bb", 1) == std::vector<std::string>{ "b" },
+            "name search over the snapshot rows");
+        inventory.begin();
+        inventory.sell("a", 2);
+        inventory.remove(std::string("c"));
+        inventory.add("d", 1, price(400));
+        std::string changed = describe(inventory);
+        expect(inventory.get_item_count() == 3 && inventory.complete("") == std::vector<std::string>{ "a", "b", "d" },
+            "changes to snapshot rows");
+        inventory.rollback();
+        expect(describe(inventory) == saved && inventory.complete("c").size() == 1, "rollback puts the rows back in the snapshot");
+        expect(inventory.redo() && describe(inventory) == changed, "redo copies the rows again");
+        store.commit_transaction();
+        expect(inventory.items_with_quantity_below(4).size() == 2 && describe(inventory) == changed,
+            "range query copies the rows in listing order");
+    }
+    {
+        // the menu keeps one change open: commit_outer logs the older changes and leaves the latest undoable
+        std::filesystem::remove_all(directory);
+        std::string kept;
+        {
+            Inventory inventory;
+            InventoryStore store(inventory, directory.string());
+            expect(store.open(), "open a store for commit_outer");
+            inventory.begin();
+            inventory.add("a", 5, price(100));
+            inventory.sell("a", 5); // retired until the transaction ends
+            inventory.add("b", 1, price(200));
+            kept = describe(inventory);
+            inventory.begin();
+            inventory.sell("b", 9);
+            expect(!inventory.has_changes(), "a failed sale is no change");
+            inventory.sell("b", 1);
+            expect(inventory.has_changes(), "a sale is a change");
+            inventory.commit_outer();
+            expect(inventory.get_transaction_depth() == 1, "commit_outer leaves one transaction open");
+            inventory.rollback();
+            expect(describe(inventory) == kept, "rollback after commit_outer undoes only the latest change");
+            store.commit();
+        }
+        Inventory inventory;
+        InventoryStore store(inventory, directory.string());
+        expect(store.open() && describe(inventory) == kept, "commit_outer logs the older changes");
+    }
+    std::filesystem::remove_all(directory);
+
+    std::cout << checks << " transaction checks, " << failures << " failed\n";
+    return failures == 0 ? 0 : 1;
+}
+
+// the whole of text as a number, or nothing, so a mistyped option is reported instead of throwing
+template <typename Number>
+std::optional<Number> parse_number(std::string_view text) {
+    Number value{};
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (error != std::errc() || end != text.data() + text.size()) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+// --bench [--sizes 10,1000,...] [--runs 3] [--out results.json] [--baseline baseline.json] [--max-regression percent]
+// Every case is timed runs times and the fastest time is kept.
+int run_bench(int argc, char* argv[]) {
+    std::vector<std::size_t> sizes = { 10, 1000, 100000, 1000000, 10000000 };
+    std::string out_path;
+    std::string baseline_path;
+    double max_regression = 10;
+    int runs = 3;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        if (option == "--sizes") {
+            sizes.clear();
+            std::string_view list = argv[i + 1];
+            while (!list.empty()) {
+                std::string_view size = list.substr(0, list.find(','));
+                std::optional<std::size_t> n = parse_number<std::size_t>(size);
+                if (!n || *n == 0) {
+                    std::cerr << "Invalid size \"" << size << "\" in --sizes, expected item counts like 10,1000\n";
+                    return 1;
+                }
+                sizes.push_back(*n);
+                list.remove_prefix(std::min(list.size(), size.size() + 1));
+            }
+            if (sizes.empty()) {
+                std::cerr << "--sizes needs at least one item count\n";
+                return 1;
             }
         }
-        else {
-            std::cout << "\nCannot sell more items than you have.";
+        else if (option == "--out") {
+            out_path = argv[i + 1];
+        }
+        else if (option == "--baseline") {
+            baseline_path = argv[i + 1];
+        }
+        else if (option == "--max-regression") {
+            std::optional<double> percent = parse_number<double>(argv[i + 1]);
+            if (!percent || *percent < 0) {
+                std::cerr << "Invalid --max-regression " << argv[i + 1] << ", expected a percentage\n";
+                return 1;
+            }
+            max_regression = *percent;
+        }
+        else if (option == "--runs") {
+            std::optional<int> count = parse_number<int>(argv[i + 1]);
+            if (!count || *count < 1) {
+                std::cerr << "Invalid --runs " << argv[i + 1] << ", expected a positive count\n";
+                return 1;
+            }
+            runs = *count;
         }
     }
 
-    void list_items() {
-        if (item_count == 0) {
-            std::cout << "\nInventory empty.";
-            return;
+    std::vector<BenchResult> results;
+    for (std::size_t n : sizes) {
+        std::cerr << "Benchmarking " << n << " items\n";
+        std::size_t first = results.size();
+        bench_size(n, results);
+        for (int run = 1; run < runs; run++) { // best of runs, to keep noise out of the comparison
+            std::vector<BenchResult> again;
+            bench_size(n, again);
+            for (std::size_t i = 0; i < again.size(); i++) {
+                results[first + i].ns_per_op = std::min(results[first + i].ns_per_op, again[i].ns_per_op);
+            }
         }
+    }
+    if (out_path.empty()) {
+        write_bench_json(std::cout, results);
+    }
+    else {
+        std::ofstream out(out_path);
+        write_bench_json(out, results);
+    }
 
-        for (int i = 0; i < item_count; i++) {
-            display_data(*items[i]);
-            std::cout << "\n";
+    if (baseline_path.empty()) {
+        return 0;
+    }
+    std::ifstream in(baseline_path);
+    if (!in) {
+        std::cerr << "Cannot open " << baseline_path << "\n";
+        return 1;
+    }
+    int regressions = 0;
+    for (const BenchResult& base : read_bench_json(in)) {
+        for (const BenchResult& result : results) {
+            if (result.name != base.name || result.ns_per_op <= base.ns_per_op * (1 + max_regression / 100)) {
+                continue;
+            }
+            std::cerr << "Regression: " << result.name << " " << result.ns_per_op << " ns/op, baseline "
+                << base.ns_per_op << " ns/op (+" << (result.ns_per_op / base.ns_per_op - 1) * 100 << "%)\n";
+            regressions++;
         }
     }
-};
+    std::cerr << regressions << " regressions over " << max_regression << "%\n";
+    return regressions == 0 ? 0 : 1;
+}
+
+// the menu only drives the Inventory API, pass --replay <log> [--swap-remove | --tombstones] [--pool]
+// [--durable <dir>] [--export <text|csv|jsonl|binary> <file>] [--stats <file> [--stats-interval <ms>]]
+// to run a transaction log instead. --data <dir> keeps the menu's inventory in dir, --bench runs the benchmarks (see run_bench).
+int main(int argc, char* argv[]) {
+    if (argc >= 2 && std::string(argv[1]) == "--txn") {
+        return check_transactions();
+    }
+    if (argc >= 2 && std::string(argv[1]) == "--bench") {
+        return run_bench(argc, argv);
+    }
+    if (argc >= 3 && std::string(argv[1]) == "--replay") {
+        RemovalMode mode = RemovalMode::Shift;
+        bool use_pool = false;
+        ReplayOutputs outputs;
+        for (int i = 3; i < argc; i++) {
+            std::string option = argv[i];
+            if (option == "--durable" && i + 1 < argc) {
+                outputs.data_directory = argv[++i];
+            }
+            else if (option == "--export" && i + 2 < argc) {
+                std::optional<ExportFormat> format = parse_export_format(argv[++i]);
+                if (!format) {
+                    std::cerr << "Unknown export format " << argv[i] << "\n";
+                    return 1;
+                }
+                outputs.export_format = *format;
+                outputs.export_path = argv[++i];
+            }
+            else if (option == "--stats" && i + 1 < argc) {
+                outputs.stats_path = argv[++i];
+            }
+            else if (option == "--stats-interval" && i + 1 < argc) {
+                outputs.stats_interval = std::chrono::milliseconds(std::max(1, std::atoi(argv[++i])));
+            }
+            else if (option == "--swap-remove") {
+                mode = RemovalMode::SwapAndPop;
+            }
+            else if (option == "--tombstones") {
+                mode = RemovalMode::Tombstone;
+            }
+            else if (option == "--pool") {
+                use_pool = true;
+            }
+        }
+        ItemPool pool;
+        return replay_log(argv[2], Inventory(mode, {}, use_pool ? &pool : nullptr), outputs);
+    }
 
-// no need to modify anything here
-int main() {
+    if (argc >= 2 && !(argc >= 3 && std::string(argv[1]) == "--data")) {
+        // an unknown or incomplete option would otherwise fall through to the menu
+        std::cerr << "Unknown option or missing argument: " << argv[1] << "\n";
+        return 1;
+    }
     int choice;
     Inventory inventory_system;
+    std::optional<InventoryStore> store;
+    if (argc >= 3) {
+        store.emplace(inventory_system, argv[2]);
+        if (!store->open()) {
+            std::cerr << store->get_error() << "\n";
+            return 1;
+        }
+        print_recovery(store->get_recovery());
+    }
+    // The latest add or sale stays open as a transaction so option 6 can undo it and option 7 redo it. It
+    // is committed, and with --data logged, when the next one is made or on exit, so a crash loses at
+    // most that one change.
+    auto keep_last_change = [&] {
+        while (inventory_system.get_transaction_depth() > 0) {
+            if (!store) {
+                inventory_system.commit();
+            }
+            else if (!store->commit_transaction()) {
+                std::cerr << store->get_error() << "\n";
+            }
+        }
+    };
+    // Every menu action runs in a savepoint on top of the change kept open. One that changed nothing is
+    // dropped, so undo still takes back the change before it; one that changed something becomes the
+    // change kept open, and the one before is committed.
+    auto keep_new_change = [&] {
+        if (!inventory_system.has_changes()) {
+            inventory_system.commit(); // empty, so this only ends the savepoint
+        }
+        else {
+            inventory_system.commit_outer();
+        }
+    };
     std::cout << "Welcome to the inventory!";
 
     while (1) {
@@ -155,17 +3996,27 @@ int main() {
             << "1. Add new item\n"
             << "2. Sell item\n"
             << "3. List items\n"
-            << "4. Exit\n\n"
+            << "4. Exit\n"
+            << "5. Search items\n"
+            << "6. Undo last change\n"
+            << "7. Redo\n\n"
             << "Enter your choice: ";
         std::cin >> choice;
+        if (std::cin.eof()) {
+            choice = 4; // end of input exits, rather than reading nothing forever
+        }
 
         switch (choice) {
         case 1:
+            inventory_system.begin();
             inventory_system.add_item();
+            keep_new_change();
             break;
 
         case 2:
+            inventory_system.begin();
             inventory_system.sell_item();
+            keep_new_change();
             break;
 
         case 3:
@@ -173,13 +4024,41 @@ int main() {
             break;
 
         case 4:
+            keep_last_change();
+            // a clean exit, so the next start loads the snapshot instead of replaying the log
+            if (store && !store->checkpoint()) {
+                std::cerr << store->get_error() << "\n";
+            }
             exit(0);
 
+        case 5:
+            inventory_system.search_items();
+            break;
+
+        case 6:
+            if (inventory_system.get_transaction_depth() > 0) {
+                inventory_system.rollback();
+                std::cout << "\nLast change undone.";
+            }
+            else {
+                std::cout << "\nNothing to undo.";
+            }
+            break;
+
+        case 7:
+            std::cout << (inventory_system.redo() ? "\nChange redone." : "\nNothing to redo.");
+            break;
+
         default:
             std::cout << "\nInvalid choice entered";
             std::cin.clear();
             std::cin.ignore(INT_MAX, '\n');
             break;
         }
+
+        // every committed menu action is made durable before the next prompt
+        if (store && !store->commit()) {
+            std::cerr << store->get_error() << "\n";
+        }
     }
 }
@@ -0,0 +1,180 @@
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fork-join pool for parallel loops over an index range, the calling thread works as worker 0. Every
+// worker owns a deque of sub-ranges: it keeps splitting its range in half, pushes one half and works on
+// the other, and a worker that runs dry steals the oldest (largest) range left in another deque. Uneven
+// work, such as stores of very different sizes or games of a week, evens out without partitioning up front.
+// Shared by InventoryCluster (task4_starter_updated_vector.cpp) and Season (task3_game_obj.h).
+class WorkStealingPool {
+private:
+    using Body = std::function<void(std::size_t worker, std::size_t begin, std::size_t end)>;
+    struct Range {
+        std::size_t begin;
+        std::size_t end;
+    };
+    struct alignas(64) Worker {
+        std::mutex lock;
+        std::deque<Range> ranges;
+    };
+    std::size_t worker_count;
+    std::unique_ptr<Worker[]> workers;
+    std::vector<std::thread> threads;
+    std::mutex job_lock; // one parallel_for at a time
+    std::mutex state_lock;
+    std::condition_variable wake; // threads wait here for the next job
+    std::condition_variable done; // and parallel_for here for the threads to finish it
+    std::uint64_t job;
+    std::size_t busy; // threads still inside the current job
+    bool stopping;
+    const Body* body;
+    std::size_t grain;
+    std::atomic<std::size_t> remaining; // indices of the current job not run yet
+
+    bool pop(std::size_t w, Range& range) {
+        std::lock_guard<std::mutex> guard(workers[w].lock);
+        if (workers[w].ranges.empty()) {
+            return false;
+        }
+        range = workers[w].ranges.back();
+        workers[w].ranges.pop_back();
+        return true;
+    }
+
+    bool steal(std::size_t w, Range& range) {
+        for (std::size_t k = 1; k < worker_count; k++) {
+            Worker& victim = workers[(w + k) % worker_count];
+            std::lock_guard<std::mutex> guard(victim.lock);
+            if (!victim.ranges.empty()) {
+                range = victim.ranges.front();
+                victim.ranges.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void work(std::size_t w) {
+        Range range;
+        while (remaining.load(std::memory_order_acquire) > 0) {
+            if (!pop(w, range) && !steal(w, range)) {
+                std::this_thread::yield(); // the last ranges are being run by others
+                continue;
+            }
+            while (range.end - range.begin > grain) {
+                std::size_t middle = range.begin + (range.end - range.begin) / 2;
+                {
+                    std::lock_guard<std::mutex> guard(workers[w].lock);
+                    workers[w].ranges.push_back(Range{ middle, range.end });
+                }
+                range.end = middle;
+            }
+            (*body)(w, range.begin, range.end);
+            remaining.fetch_sub(range.end - range.begin, std::memory_order_acq_rel);
+        }
+    }
+
+    void run(std::size_t w) {
+        std::uint64_t seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> guard(state_lock);
+                wake.wait(guard, [&] { return stopping || job != seen; });
+                if (stopping) {
+                    return;
+                }
+                seen = job;
+            }
+            work(w);
+            std::lock_guard<std::mutex> guard(state_lock);
+            if (--busy == 0) {
+                done.notify_one();
+            }
+        }
+    }
+
+public:
+    // thread_count includes the caller, 0 means one per core
+    explicit WorkStealingPool(std::size_t thread_count = 0) :
+        worker_count{ thread_count > 0 ? thread_count : std::max(1u, std::thread::hardware_concurrency()) },
+        workers{ std::make_unique<Worker[]>(worker_count) },
+        threads{},
+        job_lock{},
+        state_lock{},
+        wake{},
+        done{},
+        job{ 0 },
+        busy{ 0 },
+        stopping{ false },
+        body{ nullptr },
+        grain{ 1 },
+        remaining{ 0 } {
+        for (std::size_t w = 1; w < worker_count; w++) {
+            threads.emplace_back([this, w] { run(w); });
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> guard(state_lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+
+    std::size_t get_worker_count() const {
+        return worker_count;
+    }
+
+    // calls loop(worker, begin, end) on sub-ranges of [0, count) no longer than grain, covering every index
+    // exactly once, and returns when all of them are done. worker < get_worker_count() and no two calls with
+    // the same worker run at once, so loop can accumulate into a slot per worker without locking.
+    void parallel_for(std::size_t count, std::size_t grain_size, const Body& loop) {
+        if (count == 0) {
+            return;
+        }
+        std::lock_guard<std::mutex> job_guard(job_lock);
+        body = &loop;
+        grain = std::max<std::size_t>(1, grain_size);
+        remaining.store(count, std::memory_order_release);
+        // start every worker on an equal share, stealing takes care of the rest
+        for (std::size_t w = 0; w < worker_count; w++) {
+            std::size_t begin = count * w / worker_count;
+            std::size_t end = count * (w + 1) / worker_count;
+            if (begin < end) {
+                std::lock_guard<std::mutex> guard(workers[w].lock);
+                workers[w].ranges.push_back(Range{ begin, end });
+            }
+        }
+        {
+            std::lock_guard<std::mutex> guard(state_lock);
+            busy = worker_count - 1;
+            job++;
+        }
+        wake.notify_all();
+        work(0);
+        std::unique_lock<std::mutex> guard(state_lock);
+        done.wait(guard, [&] { return busy == 0; });
+        body = nullptr;
+    }
+};
+
+#endif // WORK_STEALING_POOL_H